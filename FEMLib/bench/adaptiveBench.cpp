@@ -0,0 +1,134 @@
+/* 涡丝附近的自适应加密与均匀加密的比较
+ * 用法: adaptiveBench [maxLevel] [refineFraction]
+ * 涡量 omega = exp(-(d / w)^2), d为到曲线 z = 0.3 sin(3 phi) 的(z方向)距离, w = 0.03
+ * 1. 从3次细分的ICOSPHERE开始, 反复 计算omega -> 误差指示子 -> 标记 -> adapt, 直到不再变化
+ * 2. 对比均匀的ICOSPHERE, 误差为三角形重心处线性插值与omega的最大差
+ * 3. 涡丝移动后加密与粗化, 转移场, 用缓存的单元矩阵重新组装, 并用AMG预条件的CG求解 (S + M) u = M omega
+ */
+#include <AdaptiveMesh.h>
+#include <Mesh.h>
+#include <CSRMatrix.h>
+#include <fem.h>
+#include <amg.h>
+#include <systemSolve.h>
+#include <timer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+using namespace FEMLib;
+
+static double vorticity(const Vec3 &p, double phase)
+{
+    double phi = std::atan2(p[1], p[0]);
+    double d = (p[2] - 0.3 * std::sin(3 * phi + phase)) / 0.03;
+    return std::exp(-d * d);
+}
+
+static double interpolationError(const Mesh &mesh, double phase)
+// 三角形重心(投影到球面)处的线性插值误差的最大值
+{
+    double err = 0;
+    long nt = mesh.triangle_count();
+#pragma omp parallel for reduction(max : err)
+    for (long t = 0; t < nt; ++t)
+    {
+        const Vec3 &a = mesh.vertices[mesh.indices[3 * t]];
+        const Vec3 &b = mesh.vertices[mesh.indices[3 * t + 1]];
+        const Vec3 &c = mesh.vertices[mesh.indices[3 * t + 2]];
+        double value = (vorticity(a, phase) + vorticity(b, phase) + vorticity(c, phase)) / 3.0;
+        err = std::max(err, std::abs(value - vorticity(normalized(a + b + c), phase)));
+    }
+    return err;
+}
+
+static void sample(const Mesh &mesh, double phase, Vec &u)
+{
+    int n = mesh.vertex_count();
+    u.resize(n);
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        u[i] = vorticity(mesh.vertices[i], phase);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int maxLevel = argc > 1 ? std::atoi(argv[1]) : 10;
+    double refineFraction = argc > 2 ? std::atof(argv[2]) : 0.05;
+    double coarsenFraction = 0.2 * refineFraction;
+
+    Mesh initial(3, ICOSPHERE);
+    AdaptiveMesh am(initial, true, maxLevel);
+    std::vector<char> refine, coarsen;
+    Vec u, eta;
+    Timer t;
+    t.start();
+    for (int it = 0; it < 4 * maxLevel; ++it)
+    {
+        sample(am.mesh, 0.0, u);
+        am.indicator(u, eta);
+        am.mark(eta, refineFraction, 0.0, refine, coarsen);
+        if (am.adapt(refine, coarsen) == 0)
+            break;
+    }
+    t.stop();
+    std::cout << "adaptive: n = " << am.numVertices() << ", error = " << interpolationError(am.mesh, 0.0)
+              << ", time " << t.elapsedMilliseconds() << "ms" << std::endl;
+
+    for (int level = 5; level <= 9; ++level)
+    {
+        Mesh uniform(level, ICOSPHERE);
+        std::cout << "uniform ICOSPHERE " << level << ": n = " << uniform.vertex_count() << ", error = " << interpolationError(uniform, 0.0) << std::endl;
+    }
+
+    // 涡丝移动: 每一步加密与粗化两次, 转移场, 重新组装并求解
+    Vec w, B, x, r, z, p, Ap;
+    for (int step = 1; step <= 4; ++step)
+    {
+        double phase = 0.1 * step;
+        t.start();
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            sample(am.mesh, phase, u);
+            am.indicator(u, eta);
+            am.mark(eta, refineFraction, coarsenFraction, refine, coarsen);
+            am.adapt(refine, coarsen);
+        }
+        am.transfer(u, w);
+        t.stop();
+        double adaptTime = t.elapsedMilliseconds();
+
+        t.start();
+        CSRMatrix M(0), S(0);
+        am.assemble(M, S);
+        addMassToStiffness(S, M);
+        t.stop();
+        double assembleTime = t.elapsedMilliseconds();
+
+        int n = am.numVertices();
+        sample(am.mesh, phase, u);
+        B.resize(n), x.resize(n), r.resize(n), z.resize(n), p.resize(n), Ap.resize(n);
+        M.MVP(u, B);
+        x.setAll(0.0);
+        t.start();
+        AMG amg;
+        amg.setup(S);
+        int iter;
+        double rel_error;
+        conjugateGradientSolve(S, amg, B, x, r, z, p, Ap, &rel_error, &iter, 1e-8, 1000);
+        t.stop();
+
+        double transferErr = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            transferErr = std::max(transferErr, std::abs(w[i] - u[i]));
+        }
+        std::cout << "step " << step << ": n = " << n << ", error = " << interpolationError(am.mesh, phase)
+                  << ", transfer error " << transferErr << ", adapt " << adaptTime << "ms, assemble " << assembleTime
+                  << "ms, AMG-PCG " << iter << " iterations " << t.elapsedMilliseconds() << "ms" << std::endl;
+    }
+    return 0;
+}
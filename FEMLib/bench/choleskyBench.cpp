@@ -0,0 +1,76 @@
+/* skyline Cholesky分解时间随线程数的变化
+ * 用法: choleskyBench [subdiv] [meshtype] [blockSize]
+ * 对每个线程数 1, 2, 4, ..., omp_get_max_threads() 分解 S + 1e-10 I 并输出时间与残差
+ */
+#include <Mesh.h>
+#include <NSMatrix.h>
+#include <fem.h>
+#include <cholesky.h>
+#include <timer.h>
+#include <omp.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+using namespace FEMLib;
+
+int main(int argc, char **argv)
+{
+    int subdiv = argc > 1 ? std::atoi(argv[1]) : 60;
+    MeshType meshtype = argc > 2 ? std::atoi(argv[2]) : SPHERE;
+    int blockSize = argc > 3 ? std::atoi(argv[3]) : 64;
+    double epsilon = 1e-10;
+
+    Mesh mesh(subdiv, meshtype);
+    NSMatrix S(mesh);
+    buildStiffnessMatrix(S);
+    int n = S.rows;
+
+    Vec b(n), x(n), r(n);
+    for (int i = 0; i < n; ++i)
+    {
+        b[i] = std::sin(0.37 * i);
+    }
+
+    Cholesky chol;
+    chol.blockSize = blockSize;
+    chol.attach(S, epsilon);
+    std::cout << "n = " << n << ", nnz(L) = " << chol.L.elements.size << ", blockSize = " << blockSize << std::endl;
+
+    int maxThreads = omp_get_max_threads();
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    double t1 = 0;
+    for (int threads : threadCounts)
+    {
+        omp_set_num_threads(threads);
+        Timer t;
+        t.start();
+        chol.compute();
+        t.stop();
+        double ms = t.elapsedMilliseconds();
+        if (threads == 1)
+        {
+            t1 = ms;
+        }
+
+        chol.solve(b, x);
+        S.MVP(x, r);
+        double res = 0, nb = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            double e = r[i] + epsilon * x[i] - b[i];
+            res += e * e;
+            nb += b[i] * b[i];
+        }
+        std::cout << "threads " << threads << ": " << ms << "ms, speedup " << t1 / ms
+                  << ", relative residual " << std::sqrt(res / nb) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+/* DeflatedCG与CG在一系列右端项上的迭代次数比较
+ * 用法: deflatedCGBench [subdiv] [k]
+ * 求解 (M + 0.01 S) u = b_s, b_s 随s缓慢变化, DeflatedCG在每次求解后更新W
+ * 最后人为地令W线性相关(重复向量与零向量), 检查refresh后W被截断, 并且求解仍然收敛, 否则返回1
+ */
+#include <Mesh.h>
+#include <NSMatrix.h>
+#include <fem.h>
+#include <deflatedCG.h>
+#include <systemSolve.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace FEMLib;
+
+int main(int argc, char **argv)
+{
+    int subdiv = argc > 1 ? std::atoi(argv[1]) : 64;
+    int k = argc > 2 ? std::atoi(argv[2]) : 8;
+    double tol = 1e-8;
+
+    Mesh mesh(subdiv, SPHERE);
+    NSMatrix A(mesh), M(mesh);
+    buildMassMatrix(M);
+    buildStiffnessMatrix(A);
+    addMassToStiffness(A, M); // A = S + M
+    int n = A.rows;
+
+    Vec b(n), u(n), r(n), p(n), Ap(n);
+    DeflatedCG dcg(n, k);
+    int iter;
+    double rel_error;
+    for (int s = 0; s < 10; ++s)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const Vec3 &v = mesh.vertices[i];
+            b[i] = std::cos(3 * v[0] + 0.1 * s) * v[2] + std::sin(5 * v[1]);
+        }
+        u.setAll(0.0);
+        conjugateGradientSolve(A, b, u, r, p, Ap, &rel_error, &iter, tol);
+        int cgIter = iter;
+        u.setAll(0.0);
+        dcg.solve(A, b, u, r, p, Ap, &rel_error, &iter, tol);
+        std::cout << "rhs " << s << ": CG " << cgIter << " iterations, DeflatedCG " << iter << " iterations, nW = " << dcg.nW << std::endl;
+    }
+
+    // 线性相关的W: W[1] = W[0], W[nW - 1] = 0
+    if (dcg.nW >= 3)
+    {
+        int before = dcg.nW;
+        std::copy(dcg.W[0].begin(), dcg.W[0].end(), dcg.W[1].begin());
+        dcg.W[before - 1].setAll(0.0);
+        dcg.refresh(A);
+        int after = dcg.nW;
+        u.setAll(0.0);
+        bool ok = dcg.solve(A, b, u, r, p, Ap, &rel_error, &iter, tol);
+        A.MVP(u, r);
+        blas_axpby(1.0, b, -1.0, r, r);
+        double res = std::sqrt(dot(r, r) / dot(b, b));
+        std::cout << "rank-deficient W: nW " << before << " -> " << after << " after refresh, " << iter << " iterations, residual " << res << std::endl;
+        if (after > before - 2 || !ok || res > 10 * tol)
+        {
+            std::cout << "DeflatedCG failed to converge with a rank-deficient W" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
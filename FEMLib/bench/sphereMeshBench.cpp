@@ -0,0 +1,83 @@
+/* SPHERE, EQUIANGULAR_SPHERE与ICOSPHERE的网格质量与求解迭代次数的比较
+ * 用法: sphereMeshBench [subdiv]
+ * ICOSPHERE选择顶点数最接近 6 subdiv^2 + 2 的细分次数
+ * 对每种网格输出 meshQuality, 以及求解 (S + M) u = M f 时CG与多重网格预条件CG的迭代次数
+ * f = 3z 时精确解为 u = z (球面上 -Laplace z = 2z), 输出相对误差以比较每个自由度的精度
+ * 最短边长决定NavierStokesSolver中对流项的稳定时间步长, 一并输出
+ */
+#include <Mesh.h>
+#include <NSMatrix.h>
+#include <fem.h>
+#include <systemSolve.h>
+#include <MultiGrid.h>
+#include <timer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace FEMLib;
+
+int main(int argc, char **argv)
+{
+    int subdiv = argc > 1 ? std::atoi(argv[1]) : 128;
+    double tol = 1e-6;
+
+    int icoLevel = 0;
+    while (std::abs(10.0 * std::pow(4.0, icoLevel + 1) - 6.0 * subdiv * subdiv) < std::abs(10.0 * std::pow(4.0, icoLevel) - 6.0 * subdiv * subdiv))
+    {
+        ++icoLevel;
+    }
+
+    MeshType types[3] = {SPHERE, EQUIANGULAR_SPHERE, ICOSPHERE};
+    int subdivs[3] = {subdiv, subdiv, icoLevel};
+    const char *names[3] = {"SPHERE", "EQUIANGULAR_SPHERE", "ICOSPHERE"};
+    for (int k = 0; k < 3; ++k)
+    {
+        Mesh mesh(subdivs[k], types[k], true);
+        MeshQuality q = meshQuality(mesh);
+        std::cout << names[k] << ", subdiv = " << subdivs[k] << ", n = " << mesh.vertex_count() << std::endl;
+        q.print();
+
+        NSMatrix A(mesh), M(mesh);
+        buildMassMatrix(M);
+        buildStiffnessMatrix(A);
+        addMassToStiffness(A, M);
+        int n = A.rows;
+
+        Vec f(n), B(n), u(n), r(n), z(n), p(n), Ap(n);
+        for (int i = 0; i < n; ++i)
+        {
+            const Vec3 &v = mesh.vertices[i];
+            f[i] = 3 * v[2];
+        }
+        M.MVP(f, B);
+
+        int iter;
+        double rel_error;
+        Timer t;
+        u.setAll(0.0);
+        t.start();
+        conjugateGradientSolve(A, B, u, r, p, Ap, &rel_error, &iter, tol, 100000);
+        t.stop();
+        std::cout << "CG: " << iter << " iterations, " << t.elapsedMilliseconds() << "ms" << std::endl;
+
+        MultiGrid mg(mesh, A);
+        mg.singular = false;
+        u.setAll(0.0);
+        t.start();
+        conjugateGradientSolve(A, mg, B, u, r, z, p, Ap, &rel_error, &iter, tol, 1000);
+        t.stop();
+        std::cout << "MG-PCG: " << iter << " iterations, " << t.elapsedMilliseconds() << "ms" << std::endl;
+
+        double err = 0, ref = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            double exact = mesh.vertices[i][2];
+            err += (u[i] - exact) * (u[i] - exact);
+            ref += exact * exact;
+        }
+        std::cout << "relative error to u = z: " << std::sqrt(err / ref) << std::endl;
+        std::cout << std::endl;
+    }
+    return 0;
+}
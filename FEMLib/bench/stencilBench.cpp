@@ -0,0 +1,60 @@
+/* StencilMatrix与CSR的SpMV比较
+ * 用法: stencilBench [subdiv] [meshtype] [reps]
+ * 比较 M + S 的CSR(NSMatrix)与StencilMatrix的MVP时间, 以及两者结果的相对差
+ */
+#include <Mesh.h>
+#include <NSMatrix.h>
+#include <StencilMatrix.h>
+#include <fem.h>
+#include <timer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace FEMLib;
+
+int main(int argc, char **argv)
+{
+    int subdiv = argc > 1 ? std::atoi(argv[1]) : 512;
+    MeshType meshtype = argc > 2 ? std::atoi(argv[2]) : SPHERE;
+    int reps = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    Mesh mesh(subdiv, meshtype, true);
+    NSMatrix A(mesh), M(mesh);
+    buildMassMatrix(M);
+    buildStiffnessMatrix(A);
+    addMassToStiffness(A, M);
+    StencilMatrix stencil(mesh, 1.0, 1.0);
+    int n = A.rows;
+
+    Vec x(n), y(n), z(n);
+    for (int i = 0; i < n; ++i)
+    {
+        x[i] = std::sin(0.37 * i) + 1.0;
+    }
+
+    A.MVP(x, y);
+    stencil.MVP(x, z);
+    std::cout << "n = " << n << ", relative difference " << (y - z).norm() / y.norm() << std::endl;
+
+    Matrix *ops[2] = {&A, &stencil};
+    const char *names[2] = {"csr", "stencil"};
+    double bytes[2] = {(double)A.row_offset[n] * (sizeof(double) + sizeof(size_t)) + (double)n * (sizeof(size_t) + 2 * sizeof(double)),
+                       4.0 * stencil.diag.size * sizeof(double) + 2.0 * n * sizeof(double)};
+    for (int k = 0; k < 2; ++k)
+    {
+        ops[k]->MVP(x, y); // 预热
+        double best = -1;
+        for (int r = 0; r < reps; ++r)
+        {
+            Timer t;
+            t.start();
+            ops[k]->MVP(x, y);
+            t.stop();
+            double ms = t.elapsedMilliseconds();
+            best = (best < 0 || ms < best) ? ms : best;
+        }
+        std::cout << names[k] << ": " << best << "ms, about " << bytes[k] / n << " bytes per row, " << bytes[k] / best * 1e-6 << " GB/s" << std::endl;
+    }
+    return 0;
+}
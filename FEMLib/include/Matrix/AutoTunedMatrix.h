@@ -0,0 +1,66 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Matrix.h>
+#include <CSRMatrix.h>
+#include <SKRMatrix.h>
+#include <TArray.h>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+class AutoTunedMatrix : public Matrix
+/* SpMV的格式与线程数的自动选择
+ * 包装一个CSR矩阵, 第一次MVP时对每个(格式, 线程数)的组合计时若干次MVP, 之后一直使用最快的组合
+ * 候选格式: CSR, 通过addFormat加入的其他格式, 以及symmetric为true时由A的下三角构成的skyline
+ *           skyline只在存储量(profile)不超过 skylineLimit * nnz 时才作为候选, 在tune时生成, 没有被选中时立即释放
+ *           各个格式的结果先与CSR比较, 不一致的格式不参与选择
+ * 候选线程数: 1, 2, 4, ... 直到omp_get_max_threads()
+ *   少于最大线程数的组合需要快10%以上才会被选中, 选中最大线程数时MVP不修改OpenMP的线程数设置
+ * 设置了FEMLIB_CACHE_DIR时, 选择的结果按 (tag, 矩阵大小, 机器) 记录在 spmv_tuning.txt 中,
+ * 之后的运行直接读取, 不再计时. 文件中每行为: tag_rows_nnz_machine 格式名 线程数 时间(ms)
+ * 作为Matrix使用, 求解器不需要修改
+ */
+{
+public:
+    struct Candidate
+    {
+        std::string name;
+        const Matrix *A;
+        int threads;
+        double time; // 单次MVP的时间(ms)
+    };
+
+    const CSRMatrix &csr;
+    std::string tag; // 区分不同的算子, 例如 "ns_1_40_A"
+    bool symmetric;
+    double skylineLimit;  // skyline的profile与nnz之比的上限
+    mutable SKRMatrix skr; // 只在tune时以及选中skyline时存在
+    mutable std::vector<std::pair<std::string, const Matrix *>> formats; // skyline存在时为最后一个
+
+    mutable std::vector<Candidate> results; // tune得到的每个组合的时间
+    mutable int format;                     // 选中的格式在formats中的下标, -1表示还没有选择
+    mutable int threads;
+    int reps;     // 每个组合计时的MVP次数
+    bool verbose; // 输出每个组合的时间
+
+    AutoTunedMatrix(const CSRMatrix &A, const std::string &tag, bool symmetric = false);
+    ~AutoTunedMatrix() = default;
+
+    void addFormat(const std::string &name, const Matrix *A); // A需要与csr表示同一个矩阵, 会清除之前的选择
+    void update();                                            // csr的数值改变后调用, 更新skyline(存在时)的数值, 保留之前的选择
+    void tune() const;                                        // 对所有组合计时并选择, 结果写入缓存文件
+    void MVP(const Vec &x, Vec &y) const;                     // 第一次调用时先读取缓存或者tune
+
+    std::string selectedFormat() const;
+    std::string cacheKey() const; // tag_rows_nnz_machine
+
+    size_t skylineProfile() const;  // A的下三角的skyline存储量
+    bool buildSkyline() const;      // profile不超过上限时生成skr并加入formats
+    void releaseSkyline() const;    // 从formats中去掉skyline并释放skr
+};
+
+std::string machineName(); // 主机名与硬件线程数, 用于区分不同机器上的选择
+
+NAMESPACE_END
@@ -16,6 +16,7 @@ public:
     TArray<size_t> elm_idx;
 
     CSRMatrix(int r) : Matrix(r, r), row_offset(r + 1, 0) {}
+    CSRMatrix(int r, int c) : Matrix(r, c), row_offset(r + 1, 0) {} // r x c的矩阵, 例如多重网格的插值算子
     CSRMatrix(Mesh &m); // 根据Mesh中每个顶点之间的连通性建立
     ~CSRMatrix() = default;
 
@@ -27,4 +28,13 @@ public:
 void blas_addMatrix(const CSRMatrix &M, double val, const CSRMatrix &S, CSRMatrix &A);
 // 计算A = S + val * M
 
+void transposeMatrix(const CSRMatrix &A, CSRMatrix &At);
+// 计算At = A^T, 每一行按列排序
+
+void multiplyMatrix(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C);
+/* 计算C = A * B (Gustavson), 每一行按列排序
+ * 先对每一行统计非零元素个数得到row_offset, 再计算数值
+ * 每个线程使用长度为B.cols的标记数组与累加数组, 行之间相互独立
+ */
+
 NAMESPACE_END
\ No newline at end of file
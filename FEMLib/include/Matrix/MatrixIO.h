@@ -0,0 +1,31 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <COOMatrix.h>
+#include <CSRMatrix.h>
+#include <string>
+
+NAMESPACE_BEGIN(FEMLib)
+
+/* 稀疏矩阵的读写, 出错时抛出std::runtime_error
+ * Matrix Market: 只支持coordinate格式, 数据类型为real, integer或pattern(值取1),
+ *   对称性为general或symmetric, symmetric读取时展开为完整的矩阵
+ *   整个文件读入内存后按行分成若干段, 各线程先统计每段的元素个数, 再并行解析到对应的位置
+ * 二进制CSR: 文件头为"FEMLCSR1"以及rows, cols, nnz(uint64), 之后依次为
+ *   row_offset[rows + 1], elm_idx[nnz](uint64)以及elements[nnz](double), 均为小端
+ */
+
+void readMatrixMarket(const std::string &path, COOMatrix &A);
+void readMatrixMarket(const std::string &path, CSRMatrix &A); // 重复的元素相加
+
+void writeMatrixMarket(const std::string &path, const COOMatrix &A);
+void writeMatrixMarket(const std::string &path, const CSRMatrix &A, bool symmetric = false);
+// symmetric为true时只写下三角部分, 文件头标记为symmetric, 要求A是对称的
+
+void readBinaryCSR(const std::string &path, CSRMatrix &A);
+void writeBinaryCSR(const std::string &path, const CSRMatrix &A);
+
+void cooToCSR(const COOMatrix &A, CSRMatrix &B);
+// 并行地将COO转换为CSR, 每一行按列排序, 重复的元素按输入的顺序相加, 见tripletsToCSR
+
+NAMESPACE_END
@@ -5,6 +5,7 @@
 #include <TArray.h>
 #include <cstdint>
 #include <CSRMatrix.h>
+#include <vector>
 
 NAMESPACE_BEGIN(FEMLib)
 
@@ -15,9 +16,11 @@ public:
     Vec elements;
     TArray<size_t> column_offset;
 
+    mutable std::vector<std::vector<double>> threadAcc; // MVP中每个线程的缓冲区, 第一次使用时分配, 之后只清零
+
     SKRMatrix() = default;
     SKRMatrix(int r) : Matrix(r, r) {}
-    SKRMatrix(CSRMatrix &A); // Initialize from CSRMatrix for Cholesky
+    SKRMatrix(const CSRMatrix &A); // Initialize from CSRMatrix for Cholesky
 
     void MVP(const Vec &x, Vec &y) const;
     void convertFromCSR(const CSRMatrix &A); // Convert a CSRMatrix to SKRMatrix
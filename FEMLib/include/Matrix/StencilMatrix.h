@@ -0,0 +1,49 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Matrix.h>
+#include <Mesh.h>
+#include <TArray.h>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+class StencilMatrix : public Matrix
+/* cube拓扑网格(CUBE, SPHERE, EQUIANGULAR_SPHERE)上 alpha * M + beta * S 的无矩阵(matrix-free)算子
+ * 每个面是 N x N (N = subdiv + 1) 的结构网格, 每个点只与本面上的6个邻点相连:
+ *   (i, j +- 1), (i +- 1, j), 以及四边形对角线方向的 (i + 1, j + D), (i - 1, j - D)
+ *   面1, 2, 4的对角线为 (i, j)-(i + 1, j + 1), D = 1, 其余的面为 (i, j + 1)-(i + 1, j), D = -1
+ * 系数按重复点的下标 t = face * N * N + i * N + j 存储, 只包含本面上三角形的贡献, 矩阵对称, 每个点存4个系数:
+ *   diag[t]: 对角, east[t]: 与(i, j + 1), north[t]: 与(i + 1, j), cross[t]: 与(i + 1, j + D)
+ * MVP:
+ *   1. 面内部(不与其他面相邻的行和列)的点在不重复的编号中逐行连续, 内层循环只用行的起始位置, 没有列下标, 可以向量化
+ *   2. 其余的点(面的边界附近)通过dupToNoDupIndex取x, 接缝上的点对它的每一个重复点所在的面求和
+ * 每个非零元素只读一次系数(对称存储时平均约4个double), CSR需要读7个double和7个列下标
+ */
+{
+public:
+    const Mesh &mesh;
+    int N;
+    double alpha; // 质量矩阵的系数
+    double beta;  // 刚度矩阵的系数
+
+    // 质量与刚度矩阵各自的模板, 以及组合后MVP使用的模板
+    Vec massDiag, massEast, massNorth, massCross;
+    Vec stiffDiag, stiffEast, stiffNorth, stiffCross;
+    Vec diag, east, north, cross;
+
+    std::vector<long> rowBase;  // 面f第i行的点(i, j)的不重复编号为 rowBase[f * N + i] + j, 该行不连续时为-1
+    std::vector<int> slowOffset; // 不在面内部的点的重复点, 第k个点为 slowVertex[k], 其重复点为 slowDup[slowOffset[k]] ~ slowDup[slowOffset[k + 1] - 1]
+    std::vector<int> slowVertex;
+    std::vector<int> slowDup;
+
+    StencilMatrix(const Mesh &mesh, double alpha = 0.0, double beta = 1.0);
+
+    void setCoefficients(double alpha, double beta); // 例如NavierStokesSolver中的 M + dt * nu * S
+    void MVP(const Vec &x, Vec &y) const;
+
+    int faceDiagonal(int face) const { return (face == 1 || face == 2 || face == 4) ? 1 : -1; }
+    double applyAt(int t, const Vec &x) const; // 重复点t所在的面的模板作用于x
+};
+
+NAMESPACE_END
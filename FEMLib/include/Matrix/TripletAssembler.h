@@ -0,0 +1,40 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <COOMatrix.h>
+#include <CSRMatrix.h>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+class TripletAssembler
+/* 通用的多线程组装, 不依赖网格的拓扑结构
+ * 并行区域中每个线程把单元矩阵的元素(i, j, val)写入自己的缓冲区, 不需要原子操作
+ * assemble时把所有缓冲区转换为CSR, 重复的(i, j)相加
+ */
+{
+public:
+    int rows;
+    int cols;
+    std::vector<std::vector<Cooef>> buffers; // 每个线程一个
+
+    TripletAssembler(int rows, int cols);
+
+    void reserve(size_t perThread);
+    void add(int i, int j, double val); // 写入当前线程(omp_get_thread_num)的缓冲区
+    size_t size() const;
+    void clear();
+
+    void assemble(CSRMatrix &A) const;
+};
+
+void tripletsToCSR(const std::vector<const Cooef *> &parts, const std::vector<size_t> &sizes, int rows, int cols, CSRMatrix &A);
+/* 将若干段三元组转换为CSR, 每一行按列排序, 重复的元素相加
+ * 1. 以 key = i * cols + j 做并行的LSD基数排序, 每一趟12位:
+ *    每个线程统计自己一段的直方图, 由直方图得到每个线程在每个桶中的写入位置, 再稳定地分散
+ * 2. 分段归约: key与前一个不同的位置为段首, 对段首计数做前缀和得到输出位置, 每个线程归约段首在自己一段中的段
+ * 3. 由排序后的行号得到row_offset
+ * 排序是稳定的, 重复元素按输入的顺序相加
+ */
+
+NAMESPACE_END
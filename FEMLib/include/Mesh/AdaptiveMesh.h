@@ -0,0 +1,88 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Mesh.h>
+#include <TArray.h>
+#include <CSRMatrix.h>
+#include <vec3.h>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+NAMESPACE_BEGIN(FEMLib)
+
+class AdaptiveMesh
+/* 最新顶点二分(newest-vertex bisection)的自适应网格, 加密与粗化后网格始终是协调的
+ * 三角形(v0, v1, v2)中v2为最新的顶点, 加密边为 v0-v1, 中点为m时两个子三角形为 (v2, v0, m), (v1, v2, m), 方向不变
+ * 初始网格中每个三角形以最长边为加密边
+ * 加密: 被标记的三角形的加密边需要二分, 一个三角形有边需要二分时它的加密边也需要二分, 重复直到不再变化(闭包)
+ *       之后每个三角形按需要二分的边递归地二分, 至多得到4个三角形
+ * 粗化: 点m是由二分得到的, 包含m的三角形都被标记粗化, 并且都是以m二分的父三角形的子三角形时, 删去m, 合并为父三角形
+ *       子三角形与m保留在树中(bisected为0), 同一条边再次二分时直接恢复, 不重新计算单元矩阵
+ * 点与三角形有id, 删除的点保留位置, mesh中的点按id顺序重新编号, 三角形按二分树的深度优先顺序排列
+ * 删除的点或保留的三角形过多时, adapt先调用compact重新编号, 各个数组的大小与当前网格成正比
+ * 每个三角形在生成时计算一次单元质量矩阵与刚度矩阵, assemble时直接使用, 没有变化的三角形不需要重新计算
+ * sphere为true时新的点投影到单位球面上
+ */
+{
+public:
+    struct Element
+    {
+        uint32_t v[3]; // 点的id, v[2]为最新的顶点
+        int parent;
+        int child[2];  // 没有二分过时为-1, 粗化后保留
+        int midpoint;  // 加密边的中点, 没有二分过时为-1, 粗化后保留
+        char bisected; // 当前是否二分, 为0时是叶子
+        int level;
+        double Mloc[2];
+        double Sloc[6];
+    };
+
+    bool sphere;
+    int maxLevel; // 二分的最大层数, 每两层边长减半
+
+    std::vector<Vec3> points;
+    std::vector<int> pointParent; // 第i个点为 pointParent[2i], pointParent[2i + 1] 的中点, 初始的点为-1
+    std::vector<char> alive;
+    std::vector<Element> elements;
+    std::vector<int> roots;
+    std::vector<int> leaves; // mesh中第t个三角形为 elements[leaves[t]]
+
+    std::vector<int> vertexToId; // mesh中的编号 -> 点的id
+    std::vector<int> idToVertex; // 点的id -> mesh中的编号, 删除的点为-1
+    std::vector<int> prevVertexToId; // 上一次adapt之前的vertexToId, transfer使用
+
+    Mesh mesh; // 当前的网格, meshtype为CUSTOM
+
+    AdaptiveMesh(const Mesh &initial, bool sphere, int maxLevel = 20);
+
+    void indicator(const Vec &u, Vec &eta) const;
+    /* 误差指示子, eta[t]为u在第t个三角形上的最大差值, 约为 h |grad u|, 并行计算
+     * 例如u为涡量时, 在涡丝附近较大
+     */
+
+    void mark(const Vec &eta, double refineFraction, double coarsenFraction, std::vector<char> &refine, std::vector<char> &coarsen) const;
+    // eta > refineFraction * max(eta) 的三角形加密, eta < coarsenFraction * max(eta) 的三角形粗化
+
+    int adapt(const std::vector<char> &refine, const std::vector<char> &coarsen);
+    /* 按当前三角形的标记先粗化再加密(各一层), 返回新增的点数减去删除的点数
+     * 之后mesh, vertexToId, idToVertex更新, 旧网格上的场通过transfer得到新网格上的值
+     */
+
+    void transfer(const Vec &oldField, Vec &newField) const;
+    // 上一次adapt前后的场的转移: 保留的点直接复制, 新的点为所在边两端的平均(线性插值), 删除的点直接丢弃
+
+    void assemble(CSRMatrix &M, CSRMatrix &S) const; // 使用缓存的单元矩阵组装质量矩阵与刚度矩阵
+
+    int numVertices() const { return vertexToId.size(); }
+    int numTriangles() const { return leaves.size(); }
+
+    int newElement(uint32_t v0, uint32_t v1, uint32_t v2, int parent);
+    int newPoint(int a, int b);
+    void bisect(int e, std::unordered_map<uint64_t, int> &edges); // edges: 需要二分的边 -> 中点的id(还没有生成时为-1)
+    void collectLeaves(); // 由二分树重新生成leaves
+    void compact();       // 丢弃不在当前二分树中的三角形与删除的点, 重新编号, mesh不变
+    void rebuild();       // 重新生成leaves, 点的编号与mesh
+};
+
+NAMESPACE_END
@@ -9,6 +9,10 @@ NAMESPACE_BEGIN(FEMLib)
 
 typedef int MeshType;
 
+#ifndef CUSTOM
+#define CUSTOM 0 // 由顶点和三角形数组直接给出的网格
+#endif
+
 class Mesh
 {
 public:
@@ -17,13 +21,15 @@ public:
     MeshType meshtype;
     int subdiv;
     int *dupToNoDupIndex;
+    TArray<int> parents; // ICOSPHERE: 第i个顶点是 parents[2i], parents[2i + 1] 的中点, 二十面体的顶点为自身
 
     size_t vertex_count() const { return vertices.size; }
     size_t triangle_count() const { return indices.size / 3; }
 
-    Mesh() = default;
+    Mesh() : meshtype(CUSTOM), subdiv(0), dupToNoDupIndex(nullptr) {}
     Mesh(int subdiv, MeshType meshtype);
     Mesh(int subdiv, MeshType meshtype, bool saveDTND);
+    Mesh(const TArray<Vec3> &vertices, const TArray<uint32_t> &indices); // 任意的三角形网格, 例如从文件导入
 
    ~Mesh(); 
 };
@@ -36,9 +42,36 @@ public:
 #define SPHERE 2
 #endif
 
+#ifndef EQUIANGULAR_SPHERE
+#define EQUIANGULAR_SPHERE 3 // 等角立方球面: 面上的坐标先做 tan(pi/4 * x) 再投影, 与SPHERE的拓扑和编号相同
+#endif
+
+#ifndef ICOSPHERE
+#define ICOSPHERE 4 // 二十面体逐次中点细分, subdiv为细分次数, 10 * 4^subdiv + 2个顶点, 前一层的顶点是后一层的前缀
+#endif
+
+struct MeshQuality
+// 网格质量, 角度单位为度
+{
+    double minAngle;
+    double maxAngle;
+    double minArea;
+    double maxArea;
+    double areaRatio; // maxArea / minArea
+    double minEdge;
+    double maxEdge;
+
+    void print() const;
+};
+
+MeshQuality meshQuality(const Mesh &m);
+
 int load_cube(Mesh &m, const int subdiv);
 int load_sphere(Mesh &m, const int subdiv);
-int load_cube(Mesh &m, const int subdiv, bool saveDTND);
-int load_sphere(Mesh &m, const int subdiv, bool saveDTND);
+int load_cube(Mesh &m, const int subdiv, int *dupToNoDupIndex);   // dupToNoDupIndex为nullptr时不保存, 否则需要6(subdiv+1)^2的空间
+int load_sphere(Mesh &m, const int subdiv, int *dupToNoDupIndex);
+int load_equiangular_sphere(Mesh &m, const int subdiv);
+int load_icosphere(Mesh &m, const int subdiv);
+int load_equiangular_sphere(Mesh &m, const int subdiv, int *dupToNoDupIndex);
 
 NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Matrix.h>
+#include <CSRMatrix.h>
+#include <chebyshev.h>
+#include <cholesky.h>
+#include <TArray.h>
+#include <memory>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+class AMGLevel
+// 代数多重网格中的一层, P为下一层(更粗)到本层的插值, R = P^T
+{
+public:
+    CSRMatrix Ac;        // 粗层的矩阵, 第0层为空
+    const CSRMatrix *A;  // 第0层指向setup的输入, 其余各层指向Ac
+    CSRMatrix P;
+    CSRMatrix R;
+    Chebyshev cheb;      // 平滑器, 同时给出 D^{-1}A 的最大特征值
+    Vec B;               // 近零空间向量, 第0层为常数向量
+
+    // cycle使用的空间, MVP为const因此使用mutable
+    mutable Vec x;
+    mutable Vec b;
+    mutable Vec r;
+    mutable Vec t;
+
+    AMGLevel() : Ac(0), A(nullptr), P(0), R(0) {}
+};
+
+/* 光滑聚集代数多重网格(smoothed aggregation AMG), 只需要CSR格式的对称正定(或半正定)矩阵
+ * setup:
+ *   1. 强连接: |a_ij| >= theta * sqrt(|a_ii a_jj|)
+ *   2. 并行聚集: 在强连接图上求距离为2的极大独立集(MIS-2), 每一轮每个未决定的点与其距离2以内的点比较
+ *      (状态, 伪随机优先级), 是最大值的点成为根, 距离2以内有根的点被排除, 各点之间相互独立
+ *      根与其强连接的邻点构成聚集, 剩下的点加入强连接的邻点所在的聚集
+ *   3. 试探插值T: 把近零空间向量B限制在每个聚集上并单位化, 粗层的B为每个聚集上B的范数
+ *   4. 光滑插值: P = (I - omega D^{-1} A) T, omega = 4 / (3 lambdaMax(D^{-1}A))
+ *   5. Galerkin粗层矩阵: A_c = P^T A P, 由两次稀疏矩阵乘法得到
+ *   直到粗层的大小不超过coarseSize, 或者层数达到maxLevels, 或者聚集不再有效地减少规模
+ *   聚集的行数减少不到minCoarsening倍, 或者平均每行非零元素超过maxRowNnz时也停止, 这一层直接分解,
+ *   避免粗层的矩阵越来越稠密, 使算子复杂度和V循环的代价变大
+ * MVP: 零初值的一次V循环, Chebyshev前后平滑, 最粗一层用setup中得到的Cholesky分解求解, 是对称正定的, 可以作为CG的预条件子
+ * solve: 以V循环为迭代的独立求解器
+ */
+class AMG : public Matrix
+{
+public:
+    double theta;         // 强连接阈值
+    int coarseSize;       // 最粗一层的大小上限
+    int maxLevels;
+    double minCoarsening; // 每一层的行数至少减少的倍数
+    double maxRowNnz;     // 粗层平均每行非零元素个数的上限, 不检查第0层
+    int preSmooth;        // 每层前平滑的Chebyshev次数
+    int postSmooth;       // 每层后平滑的Chebyshev次数
+    bool singular;        // A的核为B(例如纯Neumann问题的常数向量)时为true, 最粗一层的右端项与B正交化
+    double tol;
+    int iterMax;
+    bool verbose;
+
+    std::vector<std::unique_ptr<AMGLevel>> levels;
+    mutable Cholesky coarseCholesky; // 最粗一层的分解, 奇异时对角线加上1e-10
+
+
+    int iter;        // 上一次solve的迭代次数
+    double relError; // 上一次solve的相对残差
+
+    AMG();
+
+    void setup(const CSRMatrix &A, bool singular = false); // A需要在AMG使用期间保持有效
+    void MVP(const Vec &x, Vec &y) const;                  // y = 一次V循环(x, 0)
+    void solve(const Vec &b, Vec &x);                       // 以x为初值迭代到相对残差小于tol
+
+    int numLevels() const { return levels.size(); }
+    double operatorComplexity() const; // 各层非零元素个数之和 / 第0层非零元素个数
+    void printHierarchy() const;
+
+    void cycle(int k) const;
+    void coarseSolve(const AMGLevel &L) const;
+};
+
+void aggregate(const CSRMatrix &A, double theta, std::vector<int> &agg, int *numAgg);
+// 按强连接对A的行进行聚集, agg[i]为第i行所在聚集的编号
+
+NAMESPACE_END
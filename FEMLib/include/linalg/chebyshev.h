@@ -0,0 +1,44 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Matrix.h>
+#include <CSRMatrix.h>
+#include <TArray.h>
+
+NAMESPACE_BEGIN(FEMLib)
+
+/* Chebyshev多项式迭代, 以Jacobi(对角)为预条件
+ * 迭代过程中只有SpMV和逐元素的向量运算，不需要任何内积，适合多核并行
+ * 谱区间[lambdaMin, lambdaMax]为 D^{-1}A 的特征值范围，通过若干步PCG(Lanczos)自动估计
+ * 1. smooth: 作为多重网格的平滑器，只需要压制高频误差，使用区间[lambdaMax / smoothRatio, lambdaMax]
+ * 2. MVP: 作为CG的预条件子, y = p(A) x, 初值为零的固定次数迭代，是一个对称正定的线性算子
+ */
+class Chebyshev : public Matrix
+{
+public:
+    const CSRMatrix *A;
+    Vec invDiag;        // D^{-1}
+    double lambdaMin;   // 估计得到的 D^{-1}A 最小特征值
+    double lambdaMax;   // 估计得到的 D^{-1}A 最大特征值
+    double smoothRatio; // 平滑器使用的区间为[lambdaMax / smoothRatio, lambdaMax], 默认30, 几何多重网格中由MultiGrid设置为更小的值
+    double safety;      // Lanczos得到的lambdaMax是下估计，放大一点保证多项式在整个谱上收敛
+    int degree;         // 作为预条件子时的多项式次数
+
+    Chebyshev();
+
+    void attach(const CSRMatrix &A_CSR, int lanczosSteps = 10);
+    void estimateEigenvalues(int steps);
+    void setBounds(double lmin, double lmax);
+
+    void smooth(const Vec &b, Vec &x, int iter) const; // 以x为初值进行iter次Chebyshev平滑
+    void MVP(const Vec &x, Vec &y) const;              // 预条件子 y = p(A) x
+
+    // 迭代使用的临时空间，在attach时分配，MVP为const因此使用mutable
+    mutable Vec r;  // 残差
+    mutable Vec d;  // 更新方向
+    mutable Vec Ad; // A * d
+
+    void iterate(const Vec &b, Vec &x, bool zeroGuess, double a, double c, int iter) const;
+};
+
+NAMESPACE_END
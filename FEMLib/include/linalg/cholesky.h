@@ -7,6 +7,14 @@
 
 NAMESPACE_BEGIN(FEMLib)
 
+enum CholeskyType
+// FEMData与NavierStokesSolver中使用的Cholesky分解的种类
+{
+    SKYLINE_CHOLESKY,    // Cholesky, 按行的skyline存储
+    SKYLINE_MIXED,       // Cholesky, 单精度存储L, 双精度迭代修正
+    SUPERNODAL_CHOLESKY  // SupernodalCholesky, 嵌套剖分排序 + 超节点
+};
+
 class Cholesky
 {
 public:
@@ -14,13 +22,60 @@ public:
     SKRMatrix A;
     TArray<int> minElmIdx;
     bool isInitialized;
+    int blockSize;      // compute中分块的大小
+    int solveBlockSize; // solve中分块的大小
+
+    // analyze时分配, solve中不再分配内存
+    Vec invDiag;                // 对角线的倒数, compute时计算
+    TArray<int> blockMinElmIdx; // solve中每一块最左边的非零列
+    Vec y;                      // solve的临时空间
+
+    /* 混合精度: compute结束后L以float存储(Lf), 双精度的L被释放
+     * solve中对原来的CSR矩阵(加上epsilon)做双精度的迭代修正, 直到相对残差小于refineTol
+     * refineSteps为上一次solve的修正次数, refineStepsTotal / solveCount为平均次数
+     */
+    bool mixedPrecision;
+    TArray<float> Lf;
+    const CSRMatrix *A_CSR;
+    double epsilon;
+    double refineTol;
+    int maxRefine;
+    int refineSteps;
+    long refineStepsTotal;
+    long solveCount;
+    Vec r, d;
 
     Cholesky();
 
+    void setMixedPrecision(bool mixed); // 需要在compute之前调用
+
+    /* 分为三个阶段:
+     * analyze: 根据非零结构建立skyline结构并分配空间, 非零结构不变时只需要一次
+     * factorize: 只做数值分解, 复用analyze得到的结构和空间, 例如dt或nu改变后重新分解 M + dt * nu * S
+     * solve: 求解 (A + epsilon I) x = b
+     * attach = analyze + 复制数值, compute = 数值分解
+     */
+    void analyze(const CSRMatrix &A_CSR);
+    void factorize(const CSRMatrix &A_CSR, double epsilon = 0);
+    void solve(Vec &b, Vec &x);
+    void solve(TArray<Vec> &B, TArray<Vec> &X); // 多个右端项, 每批最多8个同时求解
+
     void attach(CSRMatrix &A_CSR);
     void attach(CSRMatrix &A_CSR, double epsilon);
     void compute();
-    void solve(Vec &b, Vec &x);
+
+    void loadValues(const CSRMatrix &A_CSR, double epsilon);
+
+    // compute中的分块计算
+    double rowDot(int i, int j) const;
+    void computeOffDiagonalBlock(int iBegin, int iEnd, int jBegin, int jEnd);
+    void computeDiagonalBlock(int iBegin, int iEnd);
+    void prepareSolve();
+    template <typename T>
+    void substitute(const T *Le, const Vec &b, Vec &x); // 求解 L L^T x = b
+    template <int K>
+    void substituteBatch(); // 在Yb上求解K个交错存储的右端项
+    Vec Yb;                 // 多右端项求解的临时空间
 };
 
 NAMESPACE_END
\ No newline at end of file
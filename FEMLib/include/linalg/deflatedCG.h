@@ -0,0 +1,48 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Matrix.h>
+#include <TArray.h>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+/* 子空间回收的压缩(deflated)共轭梯度法, 用于矩阵A不变而右端项不断变化的一系列求解
+ * (Saad, Yeung, Erhel, Guyomarc'h, A deflated version of the conjugate gradient algorithm, 2000)
+ * W为近似的最小特征向量组成的子空间, 每一步迭代将搜索方向对W做A-正交投影:
+ *      x_0 = x_{-1} + W (W^T A W)^{-1} W^T r_{-1}
+ *      p_0 = r_0 - W mu_0,             mu_j = (W^T A W)^{-1} (AW)^T r_j
+ *      p_{j+1} = beta_j p_j + r_{j+1} - W mu_{j+1}
+ * 这样W中对应的特征值相当于从谱中移除, 有效条件数变小
+ * 每次求解保存前l个搜索方向P, 求解结束后在span[W, P]上做Rayleigh-Ritz
+ * 取最小的k个Ritz向量作为新的W, 因此W随着求解次数增加而逐步逼近最小特征向量
+ */
+class DeflatedCG
+{
+public:
+    int k;     // W中最多保存的向量个数
+    int l;     // 每次求解保存的搜索方向个数
+    int nW;    // 当前W中的向量个数
+    int nP;    // 本次求解保存的搜索方向个数
+    TArray<Vec> W, AW;
+    TArray<Vec> P, AP;
+    std::vector<double> WAW; // W^T A W 的Cholesky分解, nW x nW, 按行存储下三角
+    std::vector<double> mu;  // 临时空间
+
+    DeflatedCG(int n, int k = 8, int l = 12);
+
+    void reset();                  // 清空W
+    void refresh(const Matrix &A); // A改变后重新计算AW和W^T A W, 保留W
+
+    bool solve(const Matrix &A, const Vec &B, Vec &u, Vec &r, Vec &p, Vec &Ap, double *rel_error, int *iter, double tol, int iterMax = 1000);
+    /* 参数与conjugateGradientSolve相同
+     * 求解结束后自动更新W
+     */
+
+    void project(const Vec &r); // mu = (W^T A W)^{-1} (AW)^T r
+    void harvest();             // 在span[W, P]上做Rayleigh-Ritz, 更新W
+    void factorWAW();
+    void solveWAW(const std::vector<double> &rhs); // mu = (W^T A W)^{-1} rhs
+};
+
+NAMESPACE_END
@@ -11,6 +11,9 @@ NAMESPACE_BEGIN(FEMLib)
 
 // 求解- \Delta u + u = f
 
+void massLoc(const Vec3 &AB, const Vec3 &AC, double *Mloc);  // 根据输入两个向量代表的三角形计算局部质量矩阵, Mloc[0]为对角元素, Mloc[1]为非对角元素
+void stiffLoc(const Vec3 &AB, const Vec3 &AC, double *Sloc); // 同上，计算刚度矩阵, 依次为S_AA, S_BB, S_CC, S_AB, S_AC, S_BC
+
 void buildMassMatrix(FEMatrix &M);
 /* 根据网格建立质量矩阵
  * 对于每一个三角形，
@@ -36,6 +39,13 @@ void buildMassMatrix(CSRMatrix &M, Mesh &mesh);
 void buildStiffnessMatrix(NSMatrix &S);
 void buildStiffnessMatrix(CSRMatrix &S, Mesh &mesh);
 
+/*-------------------通用网格的组装-------------------*/
+void assembleMassMatrix(CSRMatrix &M, const Mesh &mesh);
+void assembleStiffnessMatrix(CSRMatrix &S, const Mesh &mesh);
+/* 适用于任意的三角形网格(包括从数组构造的网格), 不要求cube/sphere网格的特殊拓扑
+ * 每个线程将单元矩阵写入TripletAssembler, 再统一转换为CSR, M与S的非零结构相同
+ */
+
 void addMassToStiffness(CSRMatrix &S, CSRMatrix &M);
 // 将质量矩阵加到刚度矩阵，方便定义和使用统一的MVP
 
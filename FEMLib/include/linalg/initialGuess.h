@@ -0,0 +1,41 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <Matrix.h>
+#include <TArray.h>
+
+NAMESPACE_BEGIN(FEMLib)
+
+/* 对同一个矩阵A的一系列线性系统 A x_k = b_k, 利用之前的解构造更好的初值
+ * PREVIOUS: 直接使用上一步的解(不做任何处理)
+ * EXTRAPOLATION: 按时间多项式外推, x0 = 2x_n - x_{n-1} 或 3x_n - 3x_{n-1} + x_{n-2}, 要求时间步长不变
+ * PROJECTION: 将之前的解做A-正交化得到基X, 取 x0 = X X^T b, 即在span(X)中A-范数误差最小的解
+ *             (Fischer, Projection techniques for iterative solution of Ax=b with successive right-hand sides)
+ * 同时保存 A X, 因此可以不做SpMV得到 A x0, 用于统计初值的残差
+ * A改变后需要调用reset清空历史
+ */
+class InitialGuess
+{
+public:
+    enum Mode
+    {
+        PREVIOUS,
+        EXTRAPOLATION,
+        PROJECTION
+    };
+
+    Mode mode;
+    int maxHistory; // 最多保存的历史解个数
+    int count;      // 当前保存的个数
+    int head;       // EXTRAPOLATION模式下最新的解在环形缓冲中的位置
+    TArray<Vec> X;  // PROJECTION: A-正交的基, EXTRAPOLATION: 最近的解
+    TArray<Vec> AX; // 对应的 A * X
+
+    InitialGuess(int n, Mode m = PROJECTION, int history = 8);
+
+    void reset();
+    bool guess(const Vec &b, Vec &x, Vec &Ax) const;     // 构造初值x以及 A x, 历史为空时返回false, 不修改x
+    void update(const Matrix &A, const Vec &x, Vec &Ax); // 加入新的解x, Ax为临时空间, 返回时为 A x
+};
+
+NAMESPACE_END
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <CSRMatrix.h>
+#include <TArray.h>
+
+NAMESPACE_BEGIN(FEMLib)
+
+void nestedDissection(const CSRMatrix &A, TArray<int> &perm, int leafSize = 64);
+/* 根据对称矩阵A的非零结构(邻接图)计算嵌套剖分的减少填充排序
+ * perm[new] = old, 即新编号下第new个未知量对应原来的第old个
+ * 1. 从伪外围点出发做BFS得到层次结构，取中间一层作为分隔集S
+ * 2. 去掉S中与下一层不相邻的点，使分隔集尽量薄
+ * 3. 分隔集两侧递归处理，S编号在最后
+ * 子图规模不超过leafSize时按BFS顺序直接编号
+ */
+
+void etreePostorder(const CSRMatrix &A, const TArray<int> &perm, TArray<int> &parent, TArray<int> &post);
+/* 计算排序后矩阵 P A P^T 的消去树parent以及消去树的后序遍历post
+ * 对消去树后序重排不改变填充，但使得每个子树以及每个超节点的列是连续的
+ */
+
+NAMESPACE_END
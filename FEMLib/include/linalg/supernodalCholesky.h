@@ -0,0 +1,70 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <CSRMatrix.h>
+#include <TArray.h>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+/* 超节点left-looking稀疏Cholesky分解 P A P^T = L L^T
+ * 接口与Cholesky相同: analyze(符号分解) -> factorize(数值分解) -> solve
+ * 非零结构相同的矩阵只需要analyze一次, factorize只重新计算数值
+ * analyze:
+ *   1. 嵌套剖分排序，再按消去树后序重排
+ *   2. 通过行子树计算L每一列的非零个数
+ *   3. 合并基本超节点: 父节点为j+1, j+1只有一个孩子，且两列的结构相同
+ *   4. 计算每个超节点的行结构
+ * factorize:
+ *   每个超节点的L存储为 m x w 的稠密列主序块(m为行数, w为列数)
+ *   对于超节点J, 依次找到所有更新J的后代超节点K, 计算稠密的 L_K * L_K^T 并散射到J上
+ *   然后对J做稠密的分块Cholesky
+ * 对称半正定的矩阵(如刚度矩阵)可以使用factorize(A, epsilon)在对角线加上epsilon
+ */
+class SupernodalCholesky
+{
+public:
+    int n;
+    const CSRMatrix *A;
+    double epsilon;
+    bool isInitialized;
+
+    TArray<int> perm;  // perm[new] = old
+    TArray<int> iperm; // iperm[old] = new
+
+    // 排序后矩阵下三角部分按列存储的结构, 值直接从A.elements中取
+    TArray<size_t> colPtr;
+    TArray<int> colRow;
+    TArray<size_t> colSrc; // 对应A.elements中的下标
+
+    // 超节点
+    int nsuper;
+    TArray<int> superStart;  // 第s个超节点的列为[superStart[s], superStart[s+1])
+    TArray<int> colToSuper;  // 每一列所属的超节点
+    TArray<size_t> rowPtr;   // 第s个超节点的行下标为rowIdx[rowPtr[s] .. rowPtr[s+1])
+    TArray<int> rowIdx;      // 前w个为超节点本身的列
+    TArray<size_t> valPtr;   // 第s个超节点的值块起始位置
+    Vec values;              // 所有超节点的稠密块
+
+    SupernodalCholesky();
+
+    void analyze(const CSRMatrix &A_CSR);
+    void factorize(const CSRMatrix &A_CSR, double epsilon = 0);
+    void solve(Vec &b, Vec &x);
+    void solve(TArray<Vec> &B, TArray<Vec> &X); // 多个右端项, 每批最多8个同时求解
+
+    // 与Cholesky相同的接口, attach = analyze, compute = 使用attach时的矩阵和epsilon做数值分解
+    void attach(CSRMatrix &A_CSR);
+    void attach(CSRMatrix &A_CSR, double epsilon);
+    void compute();
+
+    size_t nnzL() const; // L中存储的非零元素个数(不含超节点对角块的上三角)
+
+    mutable Vec work; // solve使用的临时空间
+
+    template <int K>
+    void substituteBatch(); // 在Yb上求解K个交错存储的右端项
+    Vec Yb;                 // 多右端项求解的临时空间
+};
+
+NAMESPACE_END
@@ -35,6 +35,13 @@ bool conjugateGradientSolve(Matrix &A, Vec &B, Vec &u, Vec &r, Vec &p, Vec &Ap,
  * int iterMax: 最大迭代次数
  */
 
+bool conjugateGradientSolve(Matrix &A, Matrix &P, Vec &B, Vec &u, Vec &r, Vec &z, Vec &p, Vec &Ap, double *rel_error, int *iter, double tol, int iterMax = 1000);
+/* 预条件共轭梯度法
+ * Matrix &P : 预条件子，P.MVP(r, z) 计算 z = P^{-1} r, 需要对称正定
+ * Vec &z: 存放预条件后残差的向量
+ * 其余参数同上, rel_error仍为 ||r|| / ||B||
+ */
+
 bool decentGradientSolve(COOMatrix &M, COOMatrix &S, Vec &B, Vec &u, double tol, int iterMax = 1000);
 
 bool conjugateGradientSolve(COOMatrix &M, COOMatrix &S, Vec &B, Vec &u, double tol, int iterMax = 1000);
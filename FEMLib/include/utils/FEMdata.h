@@ -5,9 +5,18 @@
 #include <NSMatrix.h>
 #include <Mesh.h>
 #include <vec3.h>
+#include <cholesky.h>
 
 NAMESPACE_BEGIN(FEMLib)
 
+enum FEMSolver
+// FEMData求解线性系统的方法
+{
+    FEM_CHOLESKY, // Cholesky分解, 种类由CholeskyType给出
+    FEM_MG_PCG,   // 不做分解, 使用多重网格预条件的CG, 内存与网格大小成线性关系
+    FEM_MG_FMG    // 一次FMG, 只达到离散误差的精度, 不保证残差小于tol
+};
+
 class FEMData
 // 存储求解-\Delta u + u = f的相关结果
 {
@@ -17,7 +26,8 @@ public:
     Vec u;
     Vec B;
 
-    FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos));
+    FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos), CholeskyType choleskyType = SKYLINE_CHOLESKY, FEMSolver solver = FEM_CHOLESKY);
+    FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos), FEMSolver solver); // 不使用Cholesky分解时
 };
 
 NAMESPACE_END
@@ -1,59 +1,160 @@
 #pragma once
 
 #include <NameSpace.h>
+#include <Matrix.h>
 #include <NSMatrix.h>
+#include <CSRMatrix.h>
 #include <Mesh.h>
 #include <TArray.h>
 #include <diagMatrix.h>
+#include <chebyshev.h>
+#include <cholesky.h>
+#include <memory>
+#include <vector>
 
 NAMESPACE_BEGIN(FEMLib)
 
-/* 多重网格法对有限元线性系统进行求解 Ax = b
- * 根据输入的初始网格信息生成三重粗网格
- * 使用输入的矩阵生成方法，在每个粗网格上生成矩阵
- * 对于粗网格，每一层的subdiv是前一层的一半
- * 要求初始网格subdiv为8的倍数
- * 此时对于b，粗网格的点都是原本细分网格的顶点，因此直接使用对应位置的值
+class MGLevel
+/* 多重网格中的一层
+ * 第0层使用输入的网格, 其余各层的网格由MGLevel自己生成
+ * P为下一层(更粗)到本层的插值, R = P^T, 最粗一层为空指针
+ * 网格与P, R只依赖网格, 通过shared_ptr在共享层次结构的MultiGrid之间共享, A及之后的成员每个MultiGrid各自一份
  * 坑：类成员使用初始化列表初始化时是根据成员在类中定义的顺序来的，而不是根据初始化列表的顺序
- * 因此假如初始化列表中后一项依赖之前项的初始化，应该在类成员声明时就考虑好顺序
+ * 因此coarseMesh与mesh需要在A之前声明
+ */
+{
+public:
+    std::shared_ptr<Mesh> coarseMesh; // 第0层为空
+    Mesh &mesh;
+    CSRMatrix A;
+    std::shared_ptr<CSRMatrix> P;
+    std::shared_ptr<CSRMatrix> R;
+    diagMatrix D;
+    Chebyshev cheb;
+
+    // 多色Gauss-Seidel使用的着色, 颜色c的行为 colorRows[colorOffset[c]] ~ colorRows[colorOffset[c + 1] - 1]
+    std::vector<size_t> colorOffset;
+    std::vector<int> colorRows;
+
+    // cycle使用的空间与统计信息(单位ms), MultiGrid::MVP为const因此使用mutable
+    mutable Vec x; // 本层的解(粗网格上为误差)
+    mutable Vec b; // 本层的右端项(粗网格上为限制后的残差)
+    mutable Vec r; // 残差
+    mutable Vec t; // 临时空间
+
+    mutable long visits;
+    mutable double smoothTime;
+    mutable double residualTime;
+    mutable double restrictTime;
+    mutable double prolongTime;
+    mutable double coarseTime;
+
+    MGLevel(Mesh &fine);                 // 第0层
+    MGLevel(int subdiv, MeshType type); // 生成subdiv的网格
+    explicit MGLevel(const MGLevel *shared); // 与shared使用同一个网格与P, R
+    void resetStats() const;
+};
+
+/* 多重网格法对有限元线性系统进行求解 Ax = b
+ * 从输入的网格开始, 每一层的subdiv是前一层的一半(向下取整), 直到顶点数不超过coarseSize或subdiv为1
+ *   ICOSPHERE每一层的细分次数减1, 插值由parents得到(buildNestedProlongation)
+ * 使用输入的矩阵生成方法在最细的网格上生成矩阵
+ * 插值P在构建时组装为CSR矩阵: 细网格的顶点在粗网格的参数域中所在的三角形上做线性(P1)插值
+ *   subdiv不要求是2的幂, 粗细网格不嵌套时同样适用
+ * 限制R = P^T (full weighting), 粗网格的矩阵为Galerkin算子 R A P, 由两次并行的稀疏矩阵乘法得到
+ * 限制与插值都是并行的SpMV
+ * 最粗一层的矩阵在setMatrix中做一次Cholesky分解, 每次循环只做两次三角求解
+ *   分解的是 A + 1e-10 I, singular时右端项与解取零均值, 去掉核(常数向量)方向上的分量
+ * 循环方式:
+ *   V: 每一层访问一次粗网格
+ *   W: 每一层访问两次粗网格
+ *   F: 先做一次F循环再做一次V循环
+ * 平滑器GAUSS_SEIDEL在setMatrix时对每一层的矩阵着色, 同一颜色的行并行原地更新, 不需要临时空间
+ *   对称(正向后反向)的扫描保证作为预条件子时的对称性, 相同的前后平滑次数下V循环次数约为Jacobi的一半
+ * fullMultiGrid(FMG, 嵌套迭代): 右端项逐层限制到最粗一层, 在最粗一层求解后用P插值到上一层作为初值
+ *   每一层做一次V循环, 直到最细一层. 总工作量为O(n), 一遍得到与离散误差同阶的解, 而不是残差达到tol
+ * 同一网格上的多个矩阵(例如NavierStokesSolver中的S与 M + dt * nu * S)可以共享网格与插值, 见 MultiGrid(const MultiGrid *)
+ * 每一层记录各个部分的时间, 通过printStats输出
+ * 作为Matrix使用时, MVP为零初值的一次cycleType循环, 前后平滑次数相同时是对称的, 可以作为CG的预条件子
  */
-class MultiGrid
+class MultiGrid : public Matrix
 {
 public:
+    enum SmootherType
+    {
+        JACOBI,      // 阻尼Jacobi, 阻尼系数为w
+        CHEBYSHEV,   // Chebyshev多项式平滑，谱区间自动估计
+        GAUSS_SEIDEL // 多色对称Gauss-Seidel, 每次迭代按颜色正向与反向各一遍
+    };
+
+    enum CycleType
+    {
+        V_CYCLE,
+        W_CYCLE,
+        F_CYCLE
+    };
+
     MeshType mt;
     int subdiv;
     double w;
+    double chebyshevRatio; // CHEBYSHEV平滑器的区间为[lambdaMax / chebyshevRatio, lambdaMax], 粗网格只减半时取4 ~ 10
     double tol;
+    int iterMax;
+    int coarseSize; // 最粗一层的顶点数上限
+    bool singular;  // A的核为常数向量(例如刚度矩阵)时为true, 最粗一层的右端项与解的修正取零均值
+    bool verbose;   // 输出每次迭代的残差
 
-    Mesh &m0; // 原本的网格
-    Mesh m1;  // 双重细分网格
-    Mesh m2;
-    Mesh m3;
+    std::vector<std::unique_ptr<MGLevel>> levels;
+    mutable Cholesky coarseCholesky; // 最粗一层的分解, 在setMatrix中计算, solve使用内部预先分配的空间
 
-    NSMatrix A0; // 分别对应每个网格上的矩阵
-    NSMatrix A1;
-    NSMatrix A2;
-    NSMatrix A3;
+    SmootherType smoother;
+    int preSmooth;  // 前平滑的迭代次数
+    int postSmooth; // 后平滑的迭代次数
+    CycleType cycleType;
 
-    diagMatrix D0;
+    int iter;         // 上一次solve的迭代次数
+    double relError;  // 上一次solve的相对残差
+    double solveTime; // 上一次solve的时间(ms)
 
-    Vec r0;
-    Vec r1;
-    Vec r2;
-    Vec r3;
-
-    MultiGrid(Mesh &mesh, void funcBuildMatrix(NSMatrix &M));
-    void solve(Vec &b, Vec &u);
+    MultiGrid(Mesh &mesh, int coarseSize = 1000);                                    // 只建立网格与插值, 之后通过setMatrix设置矩阵
+    MultiGrid(Mesh &mesh, void funcBuildMatrix(NSMatrix &M), int coarseSize = 1000); // 在mesh上用funcBuildMatrix生成矩阵
+    MultiGrid(Mesh &mesh, const CSRMatrix &A, int coarseSize = 1000);               // A的非零结构需要与mesh的连通性一致
+    explicit MultiGrid(const MultiGrid *hierarchy); // 与hierarchy共享各层网格与插值(hierarchy需要保持有效), 之后通过setMatrix设置矩阵
+    void setMatrix(const CSRMatrix &A); // 设置最细一层的矩阵, 重新计算粗网格上的Galerkin算子与平滑器
+    void solve(const Vec &b, Vec &u);
+    void fullMultiGrid(const Vec &b, Vec &u, int cycles = 1); // FMG, 每一层做cycles次V循环, 不检查残差
+    void MVP(const Vec &x, Vec &y) const; // y = 一次循环(b = x, 初值为0)
     void setOmega(double val) { w = val; }
+    void setSmoother(SmootherType type, int iter = 5); // 前后平滑均为iter次
+    void setCycle(CycleType type, int pre = 2, int post = 2);
 
-    // 需要来自各个网格的顶点对应信息来将b映射到各个粗网格上
-    // 因此使用在网格构建过程中得到的dupToNoDupIndex
+    int numLevels() const { return levels.size(); }
+    void cycle(int k, CycleType type) const; // 在第k层以levels[k]->b为右端项, levels[k]->x为初值做一次循环
+    void printStats() const;
+    void resetStats() const;
 
-    void projToCoarse(Vec &b, Mesh &m0, Vec &b1, Mesh &m1);                                                        // 将b从细网格m0映射到粗网格m1上，结果在b1中
-    void projToFine(Vec &b, Mesh &m0, Vec &b1, Mesh &m1);                                                          // 将b从粗网格m0映射到细网格m1上
-    void dumpedJacobi(const NSMatrix &A, const diagMatrix &D, const Vec &b, Vec &x, Vec &r, int iter);            // 重稀疏Jacobi平滑器
-    void conjugateGraidentSmooth(NSMatrix &A, Vec &b, Vec &x, int iter); // 共轭梯度平滑
-    void setZeroMean(Vec &x);
+    void dumpedJacobi(const CSRMatrix &A, const diagMatrix &D, const Vec &b, Vec &x, Vec &r, Vec &t, int iter) const; // 阻尼Jacobi平滑器, r, t为临时空间
+    void conjugateGraidentSmooth(CSRMatrix &A, Vec &b, Vec &x, int iter);                                // 共轭梯度平滑
+    void gaussSeidel(const MGLevel &L, const Vec &b, Vec &x, int iter) const;                           // 多色对称Gauss-Seidel, 原地更新x
+    void smooth(int k, const Vec &b, Vec &x, int iter) const;                                           // 根据smoother在第k层平滑
+    void coarseSolve(MGLevel &L) const;                                                                 // 最粗一层用缓存的Cholesky分解求解
+    void setZeroMean(Vec &x) const;
 };
 
-NAMESPACE_END
\ No newline at end of file
+void buildColoring(const CSRMatrix &A, std::vector<size_t> &colorOffset, std::vector<int> &colorRows);
+/* 对A的非零结构(无向图)贪心着色, 同一颜色的行之间没有非零元素, 可以并行地做Gauss-Seidel
+ * 按行的顺序给每一行选择邻点中没有使用的最小颜色
+ */
+
+void buildNestedProlongation(const Mesh &coarse, const Mesh &fine, CSRMatrix &P);
+/* 嵌套网格(ICOSPHERE)的插值, coarse的细分次数比fine少1, 由fine.parents直接得到
+ * 与中点细分的分片线性函数空间一致, 是精确的插值
+ */
+
+void buildProlongation(const Mesh &coarse, const Mesh &fine, CSRMatrix &P);
+/* 粗网格到细网格的插值, P为 fine.vertex_count() x coarse.vertex_count()
+ * 需要两个网格都是同一类型(cube或sphere)生成的网格, 并且保存了dupToNoDupIndex
+ * 使用dupToNoDupIndex得到面上(row, col)处的顶点, 每个面上的四边形按生成网格时的方向分成两个三角形
+ */
+
+NAMESPACE_END
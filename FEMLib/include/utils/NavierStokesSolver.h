@@ -4,11 +4,24 @@
 #include <Mesh.h>
 #include <TArray.h>
 #include <NSMatrix.h>
-// #include <MultiGrid.h>
+#include <MultiGrid.h>
 #include <cholesky.h>
+#include <supernodalCholesky.h>
+#include <initialGuess.h>
+#include <deflatedCG.h>
+#include <AutoTunedMatrix.h>
+#include <StencilMatrix.h>
+#include <memory>
 
 NAMESPACE_BEGIN(FEMLib)
 
+enum StreamSolver
+// NavierStokesSolver中求解Psi的方法
+{
+    STREAM_CHOLESKY, // 对S做Cholesky分解, 种类由CholeskyType给出
+    STREAM_MG_PCG    // 不做分解, Psi与Omega都用多重网格预条件的CG求解, 内存与网格大小成线性关系
+};
+
 class NavierStokesSolver
 /* 求解 NS 方程: (M + dt * nu * S) * Omega^{t+dt} = dt * M * Omega^t + dt * T(Omega^t, Psi^t)
  *                                  -S * Psi^t = M * Omega^t
@@ -34,11 +47,66 @@ public:
     double tol;
     double vol;
 
+    // 求解Psi的方法, 以及streamSolver为STREAM_CHOLESKY时S的Cholesky分解的种类, 在构造时检查
+    StreamSolver streamSolver;
+    CholeskyType choleskyType;
     Cholesky cholesky;
+    SupernodalCholesky snCholesky;
+
+    /* streamSolver为STREAM_MG_PCG时不做分解, Psi与Omega都用多重网格预条件的CG求解
+     * psiMG: S上的多重网格, S奇异, 取零均值; omegaMG: A上的多重网格, dt * nu 改变时重新计算粗网格的矩阵
+     * omegaMG与psiMG共享各层网格与插值, 因此声明在psiMG之后
+     * 迭代求解Psi时以上一步的Psi为初值
+     */
+    std::unique_ptr<MultiGrid> psiMG;
+    std::unique_ptr<MultiGrid> omegaMG;
+    Vec z;
+
+    /* 求解Omega时根据历史解构造初值
+     * omegaIter: 上一步CG的迭代次数, omegaIterTotal: 累计迭代次数
+     * omegaIterSaved: 相对于直接使用上一步解作为初值, 估计累计节省的迭代次数
+     * 估计方法: 由CG的平均收敛速率rho, 节省的次数约为 log(|r_prev| / |r_guess|) / log(1 / rho)
+     * rho由运行过程中累计的残差下降量omegaLogReduction和迭代次数omegaLogIter得到
+     * AOmega: 上一步加入历史时计算的 A * Omega, 用于得到r_prev而不必额外做一次SpMV, 历史非空时有效
+     * 在时间步之外直接修改Omega后需要调用setInitialGuess清空历史
+     */
+    InitialGuess omegaGuess;
+    Vec Ax0;
+    Vec AOmega;
+    double dtnu; // 上一次构建A时的dt * nu, 改变时需要清空历史
+    int omegaIter;
+    long omegaIterTotal;
+    double omegaIterSaved;
+    double omegaLogReduction;
+    long omegaLogIter;
 
-    NavierStokesSolver(int subdiv, MeshType meshtype);
+    /* 子空间回收的CG, A = M + dt * nu * S 不变时在每一步之间保留近似的最小特征向量
+     * useDeflation为false时使用普通的CG, 默认关闭, 通过setDeflation打开
+     * A以质量矩阵为主时(dt * nu较小)困难的是谱的高端, 回收最小特征向量收益有限
+     */
+    DeflatedCG omegaDCG;
+    bool useDeflation;
+
+    /* 直接法求解Omega, 默认关闭, 通过setDirectOmega打开
+     * A的非零结构不变, 符号分解只做一次, dt * nu 改变时只重新做数值分解
+     */
+    bool directOmega;
+    SupernodalCholesky omegaCholesky;
+
+    /* 迭代求解Omega时A的MVP通过Aop进行, 第一次使用时选择最快的格式与线程数
+     * cube拓扑的网格上Astencil作为候选格式, dt * nu 改变时与A一起更新系数
+     */
+    AutoTunedMatrix Aop;
+    std::unique_ptr<StencilMatrix> Astencil;
+
+    NavierStokesSolver(int subdiv, MeshType meshtype, CholeskyType choleskyType = SKYLINE_CHOLESKY, StreamSolver streamSolver = STREAM_CHOLESKY);
+    NavierStokesSolver(int subdiv, MeshType meshtype, StreamSolver streamSolver); // 不使用Cholesky分解时
     ~NavierStokesSolver() = default;
 
+    void setInitialGuess(InitialGuess::Mode mode, int history = 8);
+    void setDeflation(int k, int l = 12); // k = 0 时关闭
+    void setDirectOmega(bool direct);
+
     void computeStream(int *iter);
     void setZeroMean(Vec &x);
     void computeTransport();
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <NameSpace.h>
+#include <CSRMatrix.h>
+#include <SKRMatrix.h>
+#include <cholesky.h>
+#include <supernodalCholesky.h>
+#include <Mesh.h>
+#include <TArray.h>
+#include <cstdint>
+#include <string>
+
+NAMESPACE_BEGIN(FEMLib)
+
+/* 矩阵与Cholesky分解的磁盘缓存
+ * 文件格式(小端):
+ *   CacheHeader, 之后依次为各个数组, 每个数组的起始位置按64字节对齐, 可以直接映射到内存
+ *   文件末尾为CACHE_END_MARK, 用于检查文件是否完整
+ * 缓存是否有效由以下几点保证:
+ *   1. magic与CACHE_VERSION, 修改了文件格式后需要增大CACHE_VERSION
+ *   2. build, 构建时由组装与分解相关源文件的内容哈希得到(FEMLIB_CACHE_SOURCES), 修改这些代码后旧的缓存自动失效
+ *   3. key, 由调用者根据输入内容(网格、矩阵数值、epsilon等)的哈希得到
+ *   4. 各个数组的长度以及文件大小
+ * 写入时先写到临时文件再重命名, 其他进程不会读到写了一半的文件
+ * 读取失败时返回false, 调用者应重新计算
+ */
+
+static const uint32_t CACHE_VERSION = 2;
+static const uint64_t CACHE_END_MARK = 0x444E45454C42414DULL;
+
+enum CacheKind
+{
+    CACHE_CSR = 1,
+    CACHE_SKR = 2,
+    CACHE_CHOLESKY = 3,
+    CACHE_CHOLESKY_FLOAT = 4,
+    CACHE_SUPERNODAL = 5
+};
+
+struct CacheHeader
+{
+    char magic[8];     // "FEMLIBC"
+    uint32_t version;  // CACHE_VERSION
+    uint32_t kind;     // CacheKind
+    uint64_t build;    // 构建标识
+    uint64_t key;      // 调用者给出的内容哈希
+    uint64_t rows;     // 矩阵的行数
+    uint64_t count[4]; // 各个数组的元素个数
+};
+
+// FNV-1a哈希, 可以通过h把多段数据串起来
+uint64_t fnv1a(const void *data, size_t bytes, uint64_t h = 0xcbf29ce484222325ULL);
+uint64_t hashMesh(const Mesh &mesh);        // 顶点坐标与三角形
+uint64_t hashMatrix(const CSRMatrix &A);    // 非零结构与数值
+std::string cacheDirectory();               // 环境变量FEMLIB_CACHE_DIR, 未设置时为空, 表示不使用缓存
+
+bool saveCSR(const std::string &path, const CSRMatrix &A, uint64_t key);
+bool loadCSR(const std::string &path, CSRMatrix &A, uint64_t key);
+
+bool saveSKR(const std::string &path, const SKRMatrix &A, uint64_t key);
+bool loadSKR(const std::string &path, SKRMatrix &A, uint64_t key);
+
+bool saveCholesky(const std::string &path, const Cholesky &chol, uint64_t key);
+bool loadCholesky(const std::string &path, Cholesky &chol, const CSRMatrix &A, double epsilon, uint64_t key);
+/* 保存分解得到的L(混合精度时为单精度的L)
+ * 读取时先对A做analyze, 再读入L, 结果与 attach(A, epsilon) + compute() 相同
+ * chol的mixedPrecision需要在读取之前设置, 并且应当包含在key中
+ */
+
+uint64_t cacheBuildId(); // 当前构建的build
+
+bool saveSupernodalCholesky(const std::string &path, const SupernodalCholesky &chol, uint64_t key);
+bool loadSupernodalCholesky(const std::string &path, SupernodalCholesky &chol, const CSRMatrix &A, double epsilon, uint64_t key);
+/* 保存排序, 超节点划分与结构, L的值, 以及之后重新factorize所需的A的下三角结构
+ * 读取时不需要analyze, 结果与 attach(A, epsilon) + compute() 相同, 之后可以对同样结构的矩阵factorize
+ */
+
+NAMESPACE_END
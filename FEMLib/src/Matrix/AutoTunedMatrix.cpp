@@ -0,0 +1,247 @@
+#include <AutoTunedMatrix.h>
+#include <CSRMatrix.h>
+#include <SKRMatrix.h>
+#include <matrixCache.h>
+#include <TArray.h>
+#include <timer.h>
+#include <omp.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <cstdlib>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+NAMESPACE_BEGIN(FEMLib)
+
+std::string machineName()
+{
+    std::string host;
+#ifdef _WIN32
+    const char *name = std::getenv("COMPUTERNAME");
+    host = name ? name : "";
+#else
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) == 0)
+    {
+        host = name;
+    }
+#endif
+    if (host.empty())
+    {
+        host = "unknown";
+    }
+    for (char &c : host)
+    {
+        if (c == ' ' || c == '\t' || c == '_')
+            c = '-';
+    }
+    return host + "-" + std::to_string(std::thread::hardware_concurrency());
+}
+
+AutoTunedMatrix::AutoTunedMatrix(const CSRMatrix &A, const std::string &tag, bool symmetric)
+    : Matrix(A.rows, A.cols), csr(A), tag(tag), symmetric(symmetric), skylineLimit(2.0), format(-1), threads(0), reps(10), verbose(false)
+{
+    formats.push_back({"csr", &csr});
+}
+
+void AutoTunedMatrix::addFormat(const std::string &name, const Matrix *A)
+{
+    releaseSkyline();
+    formats.push_back({name, A});
+    format = -1;
+}
+
+void AutoTunedMatrix::update()
+{
+    if (!formats.empty() && formats.back().second == &skr)
+    {
+        skr.convertFromCSR(csr);
+    }
+}
+
+size_t AutoTunedMatrix::skylineProfile() const
+{
+    size_t profile = 0;
+    for (int i = 0; i < rows; ++i)
+    {
+        profile += i - (long)csr.elm_idx[csr.row_offset[i]] + 1;
+    }
+    return profile;
+}
+
+bool AutoTunedMatrix::buildSkyline() const
+{
+    if (!symmetric || skylineProfile() > skylineLimit * csr.row_offset[rows])
+    {
+        return false;
+    }
+    if (formats.back().second != &skr)
+    {
+        skr = SKRMatrix(csr);
+        skr.convertFromCSR(csr);
+        formats.push_back({"skyline", &skr});
+    }
+    return true;
+}
+
+void AutoTunedMatrix::releaseSkyline() const
+{
+    if (!formats.empty() && formats.back().second == &skr)
+    {
+        formats.pop_back();
+        skr = SKRMatrix();
+    }
+}
+
+std::string AutoTunedMatrix::cacheKey() const
+{
+    return tag + "_" + std::to_string(rows) + "_" + std::to_string(csr.row_offset[rows]) + "_" + machineName();
+}
+
+std::string AutoTunedMatrix::selectedFormat() const
+{
+    return format < 0 ? std::string() : formats[format].first;
+}
+
+static void runWithThreads(const Matrix &A, int threads, const Vec &x, Vec &y)
+// 以threads个线程计算一次MVP, 与当前的线程数相同时直接计算, 否则之后恢复原来的线程数
+{
+    int prev = omp_get_max_threads();
+    if (threads == prev)
+    {
+        A.MVP(x, y);
+        return;
+    }
+    omp_set_num_threads(threads);
+    A.MVP(x, y);
+    omp_set_num_threads(prev);
+}
+
+void AutoTunedMatrix::tune() const
+{
+    results.clear();
+    Vec x(cols), y(rows), ref(rows);
+    for (int i = 0; i < cols; ++i)
+    {
+        x[i] = std::sin(0.37 * i) + 1.0;
+    }
+    csr.MVP(x, ref);
+    double refNorm = ref.norm();
+
+    std::vector<int> threadCounts;
+    int maxThreads = omp_get_max_threads();
+    for (int t = 1; t < maxThreads; t *= 2)
+    {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    buildSkyline();
+    double best = -1, bestTime = 0;
+    for (size_t f = 0; f < formats.size(); ++f)
+    {
+        const Matrix &A = *formats[f].second;
+        // 结果与CSR不一致的格式不参与选择
+        runWithThreads(A, maxThreads, x, y);
+        double err = 0;
+        for (int i = 0; i < rows; ++i)
+        {
+            err += (y[i] - ref[i]) * (y[i] - ref[i]);
+        }
+        if (std::sqrt(err) > 1e-10 * refNorm)
+        {
+            if (verbose)
+                std::cout << "spmv tuning: " << formats[f].first << " does not match csr, skipped" << std::endl;
+            continue;
+        }
+
+        for (int t : threadCounts)
+        {
+            runWithThreads(A, t, x, y); // 预热
+            double time = -1;
+            for (int k = 0; k < reps; ++k)
+            {
+                Timer timer;
+                runWithThreads(A, t, x, y);
+                double ms = timer.elapsedMilliseconds();
+                time = (time < 0) ? ms : std::min(time, ms);
+            }
+            results.push_back({formats[f].first, &A, t, time});
+            if (verbose)
+                std::cout << "spmv tuning: " << formats[f].first << ", " << t << " threads: " << time << "ms" << std::endl;
+            // 与最大线程数相比需要快10%以上
+            double scaled = (t == maxThreads) ? time : time * 1.1;
+            if (best < 0 || scaled < best)
+            {
+                best = scaled;
+                bestTime = time;
+                format = f;
+                threads = t;
+            }
+        }
+    }
+
+    if (formats[format].second != &skr)
+    {
+        releaseSkyline();
+    }
+
+    std::string dir = cacheDirectory();
+    if (!dir.empty())
+    {
+        std::ofstream out(dir + "/spmv_tuning.txt", std::ios::app);
+        out << cacheKey() << " " << formats[format].first << " " << threads << " " << bestTime << "\n";
+    }
+}
+
+void AutoTunedMatrix::MVP(const Vec &x, Vec &y) const
+{
+    if (format < 0)
+    {
+        // 读取缓存中的选择, 同一个key以最后一行为准
+        std::string dir = cacheDirectory();
+        if (!dir.empty())
+        {
+            std::ifstream in(dir + "/spmv_tuning.txt");
+            std::string key = cacheKey(), line;
+            while (std::getline(in, line))
+            {
+                std::istringstream ls(line);
+                std::string k, name;
+                int t = 0;
+                if (!(ls >> k >> name >> t) || k != key || t < 1)
+                    continue;
+                if (name == "skyline" && !buildSkyline())
+                    continue;
+                for (size_t f = 0; f < formats.size(); ++f)
+                {
+                    if (formats[f].first == name)
+                    {
+                        format = f;
+                        threads = std::min(t, omp_get_max_threads());
+                    }
+                }
+            }
+        }
+        if (format >= 0 && formats[format].second != &skr)
+        {
+            releaseSkyline();
+        }
+        if (format < 0)
+        {
+            tune();
+        }
+        else if (verbose)
+        {
+            std::cout << "spmv tuning: " << formats[format].first << ", " << threads << " threads (cached)" << std::endl;
+        }
+    }
+    runWithThreads(*formats[format].second, threads, x, y);
+}
+
+NAMESPACE_END
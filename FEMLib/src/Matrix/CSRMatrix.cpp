@@ -102,27 +102,23 @@ CSRMatrix::CSRMatrix(Mesh &m)
 
 void CSRMatrix::MVP(const Vec &x, Vec &y) const
 {
-    if (cols != x.size || cols != y.size)
+    if (cols != x.size || rows != y.size)
     {
-        throw std::invalid_argument("Size mismatch: The number of columns in the matrix does not match the size of the vector.");
+        throw std::invalid_argument("Size mismatch: The size of the vectors does not match the size of the matrix.");
     }
-    y.setAll(0.0);
 
-    size_t offset;
-    size_t len;
-
-#pragma omp parallel for private(offset, len)
+    // 每一行只由一个线程计算, 不需要原子操作
+#pragma omp parallel for
     for (int r = 0; r < rows; ++r)
     {
-        offset = row_offset[r];
-        len = row_offset[r + 1] - offset;
-        double local_sum = 0.0; // 每个线程维护局部累加器
+        size_t offset = row_offset[r];
+        size_t len = row_offset[r + 1] - offset;
+        double local_sum = 0.0;
         for (size_t i = 0; i < len; ++i)
         {
             local_sum += elements[offset + i] * x[elm_idx[offset + i]];
         }
-#pragma omp atomic
-        y[r] += local_sum;
+        y[r] = local_sum;
     }
 }
 
@@ -135,6 +131,118 @@ void blas_addMatrix(const CSRMatrix &M, double val, const CSRMatrix &S, CSRMatri
     }
 }
 
+void transposeMatrix(const CSRMatrix &A, CSRMatrix &At)
+{
+    size_t nnz = A.row_offset[A.rows];
+    At.rows = A.cols;
+    At.cols = A.rows;
+    At.row_offset.resize(A.cols + 1);
+    At.row_offset.setAll(0);
+    At.elm_idx.resize(nnz);
+    At.elements.resize(nnz);
+
+    // 统计每一列的元素个数
+    for (size_t k = 0; k < nnz; ++k)
+    {
+        At.row_offset[A.elm_idx[k] + 1]++;
+    }
+    for (int c = 0; c < A.cols; ++c)
+    {
+        At.row_offset[c + 1] += At.row_offset[c];
+    }
+
+    // 按行的顺序写入, 每一行自然按列排序
+    std::vector<size_t> pos(At.row_offset.begin(), At.row_offset.begin() + A.cols);
+    for (int r = 0; r < A.rows; ++r)
+    {
+        for (size_t k = A.row_offset[r]; k < A.row_offset[r + 1]; ++k)
+        {
+            size_t p = pos[A.elm_idx[k]]++;
+            At.elm_idx[p] = r;
+            At.elements[p] = A.elements[k];
+        }
+    }
+}
+
+void multiplyMatrix(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C)
+{
+    if (A.cols != B.rows)
+    {
+        throw std::invalid_argument("Size mismatch: The number of columns of A does not match the number of rows of B.");
+    }
+    int n = A.rows;
+    C.rows = A.rows;
+    C.cols = B.cols;
+    C.row_offset.resize(n + 1);
+    C.row_offset[0] = 0;
+
+    // 1. 每一行的非零元素个数
+#pragma omp parallel
+    {
+        std::vector<int> mark(B.cols, -1);
+#pragma omp for schedule(dynamic, 256)
+        for (int r = 0; r < n; ++r)
+        {
+            size_t count = 0;
+            for (size_t ka = A.row_offset[r]; ka < A.row_offset[r + 1]; ++ka)
+            {
+                size_t k = A.elm_idx[ka];
+                for (size_t kb = B.row_offset[k]; kb < B.row_offset[k + 1]; ++kb)
+                {
+                    size_t c = B.elm_idx[kb];
+                    if (mark[c] != r)
+                    {
+                        mark[c] = r;
+                        ++count;
+                    }
+                }
+            }
+            C.row_offset[r + 1] = count;
+        }
+    }
+    for (int r = 0; r < n; ++r)
+    {
+        C.row_offset[r + 1] += C.row_offset[r];
+    }
+    size_t nnz = C.row_offset[n];
+    C.elm_idx.resize(nnz);
+    C.elements.resize(nnz);
+
+    // 2. 计算数值, 每一行的列下标排序后写入
+#pragma omp parallel
+    {
+        std::vector<int> mark(B.cols, -1);
+        std::vector<double> acc(B.cols, 0.0);
+#pragma omp for schedule(dynamic, 256)
+        for (int r = 0; r < n; ++r)
+        {
+            size_t begin = C.row_offset[r];
+            size_t end = begin;
+            for (size_t ka = A.row_offset[r]; ka < A.row_offset[r + 1]; ++ka)
+            {
+                size_t k = A.elm_idx[ka];
+                double a = A.elements[ka];
+                for (size_t kb = B.row_offset[k]; kb < B.row_offset[k + 1]; ++kb)
+                {
+                    size_t c = B.elm_idx[kb];
+                    if (mark[c] != r)
+                    {
+                        mark[c] = r;
+                        acc[c] = 0.0;
+                        C.elm_idx[end++] = c;
+                    }
+                    acc[c] += a * B.elements[kb];
+                }
+            }
+            std::sort(C.elm_idx.begin() + begin, C.elm_idx.begin() + end);
+            for (size_t k = begin; k < end; ++k)
+            {
+                C.elements[k] = acc[C.elm_idx[k]];
+            }
+        }
+    }
+}
+
 void CSRMatrix::print() const
 {
     // 保存 std::cout 的当前格式
@@ -0,0 +1,357 @@
+#include <MatrixIO.h>
+#include <COOMatrix.h>
+#include <CSRMatrix.h>
+#include <TripletAssembler.h>
+#include <TArray.h>
+#include <omp.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    in.seekg(0, std::ios::end);
+    size_t size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    std::string buf(size, '\0');
+    in.read(&buf[0], size);
+    if (!in)
+    {
+        throw std::runtime_error("Cannot read file: " + path);
+    }
+    return buf;
+}
+
+static void writeFile(const std::string &path, const std::vector<std::string> &parts)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    }
+    for (const std::string &p : parts)
+    {
+        out.write(p.data(), p.size());
+    }
+    if (!out)
+    {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+static const char *nextLine(const char *p, const char *end)
+// 返回下一行的开始位置
+{
+    const char *q = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return q ? q + 1 : end;
+}
+
+static bool isDataLine(const char *p, const char *end)
+// 跳过空行与注释行
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+    return p < end && *p != '\n' && *p != '\r' && *p != '%';
+}
+
+static void lowerCase(std::string &s)
+{
+    for (char &c : s)
+    {
+        c = std::tolower((unsigned char)c);
+    }
+}
+
+void readMatrixMarket(const std::string &path, COOMatrix &A)
+{
+    std::string buf = readFile(path);
+    const char *begin = buf.data();
+    const char *end = begin + buf.size();
+
+    // 文件头: %%MatrixMarket matrix coordinate real general
+    const char *line = begin;
+    const char *next = nextLine(line, end);
+    std::istringstream header(std::string(line, next));
+    std::string banner, object, format, field, symmetry;
+    header >> banner >> object >> format >> field >> symmetry;
+    lowerCase(object);
+    lowerCase(format);
+    lowerCase(field);
+    lowerCase(symmetry);
+    if (banner != "%%MatrixMarket" || object != "matrix")
+    {
+        throw std::runtime_error("Not a Matrix Market file: " + path);
+    }
+    if (format != "coordinate")
+    {
+        throw std::runtime_error("Only the coordinate Matrix Market format is supported: " + path);
+    }
+    bool pattern = field == "pattern";
+    if (!pattern && field != "real" && field != "integer")
+    {
+        throw std::runtime_error("Unsupported Matrix Market field '" + field + "': " + path);
+    }
+    bool symmetric = symmetry == "symmetric";
+    if (!symmetric && symmetry != "general")
+    {
+        throw std::runtime_error("Unsupported Matrix Market symmetry '" + symmetry + "': " + path);
+    }
+
+    // 跳过注释, 读取大小
+    line = next;
+    while (line < end && !isDataLine(line, end))
+    {
+        line = nextLine(line, end);
+    }
+    long rows, cols, entries;
+    if (line >= end || std::sscanf(std::string(line, nextLine(line, end)).c_str(), "%ld %ld %ld", &rows, &cols, &entries) != 3)
+    {
+        throw std::runtime_error("Missing size line in Matrix Market file: " + path);
+    }
+    const char *body = nextLine(line, end);
+
+    // 按行分段, 每个线程统计自己一段中的元素个数
+    int nt = omp_get_max_threads();
+    std::vector<const char *> chunk(nt + 1);
+    chunk[0] = body;
+    chunk[nt] = end;
+    for (int t = 1; t < nt; ++t)
+    {
+        const char *p = body + (end - body) * t / nt;
+        chunk[t] = (p == body) ? body : nextLine(p - 1, end);
+        chunk[t] = std::max(chunk[t], chunk[t - 1]);
+    }
+    std::vector<long> count(nt + 1, 0);
+#pragma omp parallel for num_threads(nt)
+    for (int t = 0; t < nt; ++t)
+    {
+        long c = 0;
+        for (const char *p = chunk[t]; p < chunk[t + 1]; p = nextLine(p, chunk[t + 1]))
+        {
+            c += isDataLine(p, chunk[t + 1]);
+        }
+        count[t + 1] = c;
+    }
+    for (int t = 0; t < nt; ++t)
+    {
+        count[t + 1] += count[t];
+    }
+    if (count[nt] != entries)
+    {
+        throw std::runtime_error("Matrix Market file has " + std::to_string(count[nt]) + " entries, header says " + std::to_string(entries) + ": " + path);
+    }
+
+    // 并行解析
+    std::vector<Cooef> coo(entries);
+    std::vector<long> offDiag(nt + 1, 0);
+    bool bad = false;
+#pragma omp parallel for num_threads(nt) reduction(|| : bad)
+    for (int t = 0; t < nt; ++t)
+    {
+        long k = count[t];
+        long off = 0;
+        for (const char *p = chunk[t]; p < chunk[t + 1]; p = nextLine(p, chunk[t + 1]))
+        {
+            if (!isDataLine(p, chunk[t + 1]))
+                continue;
+            char *q;
+            long i = std::strtol(p, &q, 10);
+            long j = std::strtol(q, &q, 10);
+            double v = pattern ? 1.0 : std::strtod(q, &q);
+            if (i < 1 || i > rows || j < 1 || j > cols)
+            {
+                bad = true;
+                break;
+            }
+            coo[k].i = i - 1;
+            coo[k].j = j - 1;
+            coo[k].val = v;
+            off += (i != j);
+            ++k;
+        }
+        offDiag[t + 1] = off;
+    }
+    if (bad)
+    {
+        throw std::runtime_error("Invalid entry in Matrix Market file: " + path);
+    }
+
+    // symmetric: 补上另一半
+    long total = entries;
+    if (symmetric)
+    {
+        for (int t = 0; t < nt; ++t)
+        {
+            offDiag[t + 1] += offDiag[t];
+        }
+        total += offDiag[nt];
+    }
+
+    delete[] A.cooefs;
+    A.cooefs = new Cooef[total];
+    A.rows = rows;
+    A.cols = cols;
+    A.nnz = total;
+#pragma omp parallel for num_threads(nt)
+    for (int t = 0; t < nt; ++t)
+    {
+        long m = entries + offDiag[t];
+        for (long k = count[t]; k < count[t + 1]; ++k)
+        {
+            A.cooefs[k] = coo[k];
+            if (symmetric && coo[k].i != coo[k].j)
+            {
+                A.cooefs[m].i = coo[k].j;
+                A.cooefs[m].j = coo[k].i;
+                A.cooefs[m].val = coo[k].val;
+                ++m;
+            }
+        }
+    }
+}
+
+void readMatrixMarket(const std::string &path, CSRMatrix &A)
+{
+    COOMatrix coo;
+    readMatrixMarket(path, coo);
+    cooToCSR(coo, A);
+}
+
+void writeMatrixMarket(const std::string &path, const COOMatrix &A)
+{
+    int nt = omp_get_max_threads();
+    std::vector<std::string> parts(nt + 1);
+    parts[0] = "%%MatrixMarket matrix coordinate real general\n" + std::to_string(A.rows) + " " + std::to_string(A.cols) + " " + std::to_string(A.nnz) + "\n";
+#pragma omp parallel for num_threads(nt)
+    for (int t = 0; t < nt; ++t)
+    {
+        long b = (long)A.nnz * t / nt;
+        long e = (long)A.nnz * (t + 1) / nt;
+        std::string out;
+        char tmp[96];
+        for (long k = b; k < e; ++k)
+        {
+            const Cooef &c = A.cooefs[k];
+            int len = std::snprintf(tmp, sizeof(tmp), "%d %d %.17g\n", c.i + 1, c.j + 1, c.val);
+            out.append(tmp, len);
+        }
+        parts[t + 1] = std::move(out);
+    }
+    writeFile(path, parts);
+}
+
+void writeMatrixMarket(const std::string &path, const CSRMatrix &A, bool symmetric)
+{
+    int nt = omp_get_max_threads();
+    std::vector<std::string> parts(nt + 1);
+    std::vector<long> count(nt, 0);
+#pragma omp parallel for num_threads(nt)
+    for (int t = 0; t < nt; ++t)
+    {
+        long rb = (long)A.rows * t / nt;
+        long re = (long)A.rows * (t + 1) / nt;
+        std::string out;
+        char tmp[96];
+        long c = 0;
+        for (long r = rb; r < re; ++r)
+        {
+            for (size_t k = A.row_offset[r]; k < A.row_offset[r + 1]; ++k)
+            {
+                long col = A.elm_idx[k];
+                if (symmetric && col > r)
+                    continue;
+                int len = std::snprintf(tmp, sizeof(tmp), "%ld %ld %.17g\n", r + 1, col + 1, A.elements[k]);
+                out.append(tmp, len);
+                ++c;
+            }
+        }
+        parts[t + 1] = std::move(out);
+        count[t] = c;
+    }
+    long nnz = 0;
+    for (long c : count)
+    {
+        nnz += c;
+    }
+    parts[0] = std::string("%%MatrixMarket matrix coordinate real ") + (symmetric ? "symmetric" : "general") + "\n" + std::to_string(A.rows) + " " + std::to_string(A.cols) + " " + std::to_string(nnz) + "\n";
+    writeFile(path, parts);
+}
+
+static const char BINARY_CSR_MAGIC[8] = {'F', 'E', 'M', 'L', 'C', 'S', 'R', '1'};
+
+void writeBinaryCSR(const std::string &path, const CSRMatrix &A)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    }
+    uint64_t size[3] = {(uint64_t)A.rows, (uint64_t)A.cols, (uint64_t)A.row_offset[A.rows]};
+    std::vector<uint64_t> offset(A.row_offset.begin(), A.row_offset.end());
+    std::vector<uint64_t> idx(A.elm_idx.begin(), A.elm_idx.begin() + size[2]);
+    out.write(BINARY_CSR_MAGIC, sizeof(BINARY_CSR_MAGIC));
+    out.write(reinterpret_cast<const char *>(size), sizeof(size));
+    out.write(reinterpret_cast<const char *>(offset.data()), offset.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(idx.data()), idx.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(A.elements.data), size[2] * sizeof(double));
+    if (!out)
+    {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+void readBinaryCSR(const std::string &path, CSRMatrix &A)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    char magic[8];
+    uint64_t size[3];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(size), sizeof(size));
+    if (!in || std::memcmp(magic, BINARY_CSR_MAGIC, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error("Not a FEMLib binary CSR file: " + path);
+    }
+    std::vector<uint64_t> offset(size[0] + 1), idx(size[2]);
+    Vec elements(size[2]);
+    in.read(reinterpret_cast<char *>(offset.data()), offset.size() * sizeof(uint64_t));
+    in.read(reinterpret_cast<char *>(idx.data()), idx.size() * sizeof(uint64_t));
+    in.read(reinterpret_cast<char *>(elements.data), size[2] * sizeof(double));
+    if (!in || offset[size[0]] != size[2])
+    {
+        throw std::runtime_error("Truncated or corrupt binary CSR file: " + path);
+    }
+
+    A.rows = size[0];
+    A.cols = size[1];
+    A.row_offset.resize(size[0] + 1);
+    A.elm_idx.resize(size[2]);
+    std::copy(offset.begin(), offset.end(), A.row_offset.begin());
+    std::copy(idx.begin(), idx.end(), A.elm_idx.begin());
+    A.elements = elements;
+}
+
+void cooToCSR(const COOMatrix &A, CSRMatrix &B)
+{
+    tripletsToCSR({A.cooefs}, {(size_t)A.nnz}, A.rows, A.cols, B);
+}
+
+NAMESPACE_END
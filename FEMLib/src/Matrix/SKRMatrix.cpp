@@ -4,10 +4,14 @@
 #include <CSRMatrix.h>
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
 
 NAMESPACE_BEGIN(FEMLib)
 
-SKRMatrix::SKRMatrix(CSRMatrix &A)
+SKRMatrix::SKRMatrix(const CSRMatrix &A)
     : Matrix(A.rows, A.rows), column_offset(A.rows + 1, 0)
 {
     // 输入A假定一定是对称正定的，寻找A每一行最左端的非零元素下标
@@ -22,24 +26,66 @@ SKRMatrix::SKRMatrix(CSRMatrix &A)
 };
 
 void SKRMatrix::MVP(const Vec &x, Vec &y) const
+/* 只存储了下三角部分, y = L x + L^T x - D x
+ * 第row行: y[row] += sum_j L(row, j) x[j], 同时 y[j] += L(row, j) x[row] (j < row)
+ * 每个线程负责连续的若干行, 第二部分先累加到线程自己的缓冲区中,
+ * 缓冲区覆盖这些行的skyline所涉及的列, 最后再加到y上
+ * 缓冲区保存在threadAcc中, 线程数与行的划分不变时不需要重新分配
+ */
 {
-    if (cols != x.size || cols != y.size)
+    if (cols != x.size || rows != y.size)
     {
-        throw std::invalid_argument("Size mismatch: The number of columns in the matrix does not match the size of the vector.");
+        throw std::invalid_argument("Size mismatch: The size of the vectors does not match the size of the matrix.");
     }
     y.setAll(0.0);
 
-    int start;
-    int len;
-#pragma omp parallel for private(start, len)
-    for (int row = 0; row < rows; ++row)
+#pragma omp parallel
     {
-        start = column_offset[row];
-        len = column_offset[row + 1] - start;
-        for (int i = 0; i < len; ++i)
+        int nt = omp_get_num_threads();
+        int t = omp_get_thread_num();
+        int lo = (long)rows * t / nt;
+        int hi = (long)rows * (t + 1) / nt;
+
+        int jmin = hi;
+        for (int row = lo; row < hi; ++row)
+        {
+            jmin = std::min(jmin, row + 1 - (int)(column_offset[row + 1] - column_offset[row]));
+        }
+#pragma omp single
+        if ((int)threadAcc.size() != nt)
+        {
+            threadAcc.resize(nt);
+        }
+        // single结束时有隐式的同步, 之后每个线程只访问自己的缓冲区
+        std::vector<double> &buffer = threadAcc[t];
+        if ((int)buffer.size() < hi - jmin)
+        {
+            buffer.resize(hi - jmin);
+        }
+        double *acc = buffer.data();
+        std::fill(acc, acc + (hi - jmin), 0.0);
+
+        for (int row = lo; row < hi; ++row)
+        {
+            size_t start = column_offset[row];
+            int len = column_offset[row + 1] - start;
+            int first = row + 1 - len; // 最左端非零元素的列
+            double sum = elements[start + len - 1] * x[row];
+            for (int i = 0; i < len - 1; ++i)
+            {
+                sum += elements[start + i] * x[first + i];
+                acc[first + i - jmin] += elements[start + i] * x[row];
+            }
+            acc[row - jmin] += sum;
+        }
+
+        for (int j = jmin; j < hi; ++j)
         {
+            if (acc[j - jmin] != 0.0)
+            {
 #pragma omp atomic
-            y[row] += x[row] * elements[start + i];
+                y[j] += acc[j - jmin];
+            }
         }
     }
 }
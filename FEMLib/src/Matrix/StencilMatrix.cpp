@@ -0,0 +1,238 @@
+#include <StencilMatrix.h>
+#include <fem.h>
+#include <vec3.h>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(FEMLib)
+
+StencilMatrix::StencilMatrix(const Mesh &mesh, double alpha, double beta)
+    : Matrix(mesh.vertex_count(), mesh.vertex_count()), mesh(mesh), N(mesh.subdiv + 1), alpha(alpha), beta(beta)
+{
+    if ((mesh.meshtype != CUBE && mesh.meshtype != SPHERE && mesh.meshtype != EQUIANGULAR_SPHERE) || mesh.dupToNoDupIndex == nullptr)
+    {
+        throw std::invalid_argument("StencilMatrix requires a generated cube or sphere mesh with dupToNoDupIndex.");
+    }
+    const int *dd = mesh.dupToNoDupIndex;
+    size_t total = 6 * (size_t)N * N;
+    Vec *arrays[8] = {&massDiag, &massEast, &massNorth, &massCross, &stiffDiag, &stiffEast, &stiffNorth, &stiffCross};
+    for (Vec *a : arrays)
+    {
+        a->resize(total);
+        a->setAll(0.0);
+    }
+
+    // 按生成网格时的方式遍历每个面上的三角形, 面之间互不影响
+#pragma omp parallel for
+    for (int face = 0; face < 6; ++face)
+    {
+        int D = faceDiagonal(face);
+        for (int i = 0; i + 1 < N; ++i)
+        {
+            for (int j = 0; j + 1 < N; ++j)
+            {
+                int t0 = face * N * N + i * N + j; // 左下
+                int t1 = t0 + 1;                   // 右下
+                int t2 = t0 + N;                   // 左上
+                int t3 = t2 + 1;                   // 右上
+                int tri[2][3];
+                if (D == 1)
+                {
+                    int a[2][3] = {{t1, t0, t3}, {t0, t2, t3}};
+                    std::copy(&a[0][0], &a[0][0] + 6, &tri[0][0]);
+                }
+                else
+                {
+                    int a[2][3] = {{t0, t1, t2}, {t1, t3, t2}};
+                    std::copy(&a[0][0], &a[0][0] + 6, &tri[0][0]);
+                }
+
+                for (int k = 0; k < 2; ++k)
+                {
+                    int *v = tri[k];
+                    const Vec3 &A = mesh.vertices[dd[v[0]]];
+                    Vec3 AB = mesh.vertices[dd[v[1]]] - A;
+                    Vec3 AC = mesh.vertices[dd[v[2]]] - A;
+                    double Mloc[2], Sloc[6];
+                    massLoc(AB, AC, Mloc);
+                    stiffLoc(AB, AC, Sloc);
+
+                    for (int a = 0; a < 3; ++a)
+                    {
+                        massDiag[v[a]] += Mloc[0];
+                        stiffDiag[v[a]] += Sloc[a];
+                    }
+                    // 边 AB, AC, BC, 系数存在行号(之后列号)较小的一端
+                    int pairs[3][2] = {{v[0], v[1]}, {v[0], v[2]}, {v[1], v[2]}};
+                    for (int e = 0; e < 3; ++e)
+                    {
+                        int p = std::min(pairs[e][0], pairs[e][1]);
+                        int q = std::max(pairs[e][0], pairs[e][1]);
+                        Vec *M, *S;
+                        if (q / N == p / N)
+                        {
+                            M = &massEast, S = &stiffEast;
+                        }
+                        else if (q % N == p % N)
+                        {
+                            M = &massNorth, S = &stiffNorth;
+                        }
+                        else
+                        {
+                            M = &massCross, S = &stiffCross;
+                        }
+                        (*M)[p] += Mloc[1];
+                        (*S)[p] += Sloc[3 + e];
+                    }
+                }
+            }
+        }
+    }
+
+    // 面内部的行: 第1 ~ N - 2列的不重复编号连续时记录行的起始位置
+    rowBase.assign(6 * N, -1);
+#pragma omp parallel for
+    for (int fi = 0; fi < 6 * N; ++fi)
+    {
+        int i = fi % N;
+        if (i < 1 || i > N - 2)
+            continue;
+        const int *row = dd + (size_t)fi * N;
+        bool contiguous = true;
+        for (int j = 2; j <= N - 2; ++j)
+        {
+            contiguous = contiguous && (row[j] == row[1] + j - 1);
+        }
+        if (contiguous)
+            rowBase[fi] = (long)row[1] - 1;
+    }
+
+    // 不由内部循环计算的点, 记录它们所有的重复点
+    std::vector<char> fast(rows, 0);
+    for (int face = 0; face < 6; ++face)
+    {
+        for (int i = 2; i <= N - 3; ++i)
+        {
+            int fi = face * N + i;
+            if (rowBase[fi - 1] < 0 || rowBase[fi] < 0 || rowBase[fi + 1] < 0)
+                continue;
+            for (int j = 2; j <= N - 3; ++j)
+            {
+                fast[rowBase[fi] + j] = 1;
+            }
+        }
+    }
+    std::vector<int> count(rows, 0);
+    for (size_t t = 0; t < total; ++t)
+    {
+        if (!fast[dd[t]])
+            count[dd[t]]++;
+    }
+    slowOffset.assign(1, 0);
+    std::vector<int> position(rows, -1);
+    for (int v = 0; v < rows; ++v)
+    {
+        if (!fast[v])
+        {
+            position[v] = slowVertex.size();
+            slowVertex.push_back(v);
+            slowOffset.push_back(slowOffset.back() + count[v]);
+        }
+    }
+    slowDup.resize(slowOffset.back());
+    std::vector<int> fill(slowOffset.begin(), slowOffset.end() - 1);
+    for (size_t t = 0; t < total; ++t)
+    {
+        int v = dd[t];
+        if (!fast[v])
+            slowDup[fill[position[v]]++] = t;
+    }
+
+    setCoefficients(alpha, beta);
+}
+
+void StencilMatrix::setCoefficients(double alpha, double beta)
+{
+    this->alpha = alpha;
+    this->beta = beta;
+    size_t total = massDiag.size;
+    diag.resize(total);
+    east.resize(total);
+    north.resize(total);
+    cross.resize(total);
+#pragma omp parallel for
+    for (long t = 0; t < (long)total; ++t)
+    {
+        diag[t] = alpha * massDiag[t] + beta * stiffDiag[t];
+        east[t] = alpha * massEast[t] + beta * stiffEast[t];
+        north[t] = alpha * massNorth[t] + beta * stiffNorth[t];
+        cross[t] = alpha * massCross[t] + beta * stiffCross[t];
+    }
+}
+
+double StencilMatrix::applyAt(int t, const Vec &x) const
+{
+    const int *dd = mesh.dupToNoDupIndex;
+    int face = t / (N * N);
+    int i = (t / N) % N;
+    int j = t % N;
+    int D = faceDiagonal(face);
+
+    double sum = diag[t] * x[dd[t]];
+    if (j + 1 < N)
+        sum += east[t] * x[dd[t + 1]];
+    if (j > 0)
+        sum += east[t - 1] * x[dd[t - 1]];
+    if (i + 1 < N)
+        sum += north[t] * x[dd[t + N]];
+    if (i > 0)
+        sum += north[t - N] * x[dd[t - N]];
+    if (i + 1 < N && j + D >= 0 && j + D < N)
+        sum += cross[t] * x[dd[t + N + D]];
+    if (i > 0 && j - D >= 0 && j - D < N)
+        sum += cross[t - N - D] * x[dd[t - N - D]];
+    return sum;
+}
+
+void StencilMatrix::MVP(const Vec &x, Vec &y) const
+{
+    // 面的内部, 只用到行的起始位置
+#pragma omp parallel for schedule(static)
+    for (int fi = 0; fi < 6 * N; ++fi)
+    {
+        int i = fi % N;
+        if (i < 2 || i > N - 3 || rowBase[fi - 1] < 0 || rowBase[fi] < 0 || rowBase[fi + 1] < 0)
+            continue;
+        int D = faceDiagonal(fi / N);
+        size_t t = (size_t)fi * N;
+        const double *x0 = x.data + rowBase[fi - 1];
+        const double *x1 = x.data + rowBase[fi];
+        const double *x2 = x.data + rowBase[fi + 1];
+        double *y1 = y.data + rowBase[fi];
+        const double *d = diag.data + t;
+        const double *e = east.data + t;
+        const double *n = north.data + t;
+        const double *nPrev = north.data + t - N;
+        const double *c = cross.data + t;
+        const double *cPrev = cross.data + t - N;
+#pragma omp simd
+        for (int j = 2; j <= N - 3; ++j)
+        {
+            y1[j] = d[j] * x1[j] + e[j] * x1[j + 1] + e[j - 1] * x1[j - 1] + n[j] * x2[j] + nPrev[j] * x0[j] + c[j] * x2[j + D] + cPrev[j - D] * x0[j - D];
+        }
+    }
+
+    // 面的边界附近与接缝上的点
+    long ns = slowVertex.size();
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < ns; ++k)
+    {
+        double sum = 0;
+        for (int q = slowOffset[k]; q < slowOffset[k + 1]; ++q)
+        {
+            sum += applyAt(slowDup[q], x);
+        }
+        y[slowVertex[k]] = sum;
+    }
+}
+
+NAMESPACE_END
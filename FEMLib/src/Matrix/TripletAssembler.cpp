@@ -0,0 +1,199 @@
+#include <TripletAssembler.h>
+#include <COOMatrix.h>
+#include <CSRMatrix.h>
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+NAMESPACE_BEGIN(FEMLib)
+
+TripletAssembler::TripletAssembler(int rows, int cols)
+    : rows(rows), cols(cols), buffers(omp_get_max_threads())
+{
+}
+
+void TripletAssembler::reserve(size_t perThread)
+{
+    for (auto &b : buffers)
+    {
+        b.reserve(perThread);
+    }
+}
+
+void TripletAssembler::add(int i, int j, double val)
+{
+    buffers[omp_get_thread_num()].push_back({i, j, val});
+}
+
+size_t TripletAssembler::size() const
+{
+    size_t n = 0;
+    for (const auto &b : buffers)
+    {
+        n += b.size();
+    }
+    return n;
+}
+
+void TripletAssembler::clear()
+{
+    for (auto &b : buffers)
+    {
+        b.clear();
+    }
+}
+
+void TripletAssembler::assemble(CSRMatrix &A) const
+{
+    std::vector<const Cooef *> parts;
+    std::vector<size_t> sizes;
+    for (const auto &b : buffers)
+    {
+        parts.push_back(b.data());
+        sizes.push_back(b.size());
+    }
+    tripletsToCSR(parts, sizes, rows, cols, A);
+}
+
+struct KeyVal
+{
+    uint64_t key;
+    double val;
+};
+
+static const int RADIX_BITS = 12;
+static const int RADIX = 1 << RADIX_BITS;
+
+void tripletsToCSR(const std::vector<const Cooef *> &parts, const std::vector<size_t> &sizes, int rows, int cols, CSRMatrix &A)
+{
+    size_t n = 0;
+    std::vector<size_t> partStart(parts.size() + 1, 0);
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        n += sizes[p];
+        partStart[p + 1] = n;
+    }
+
+    std::vector<KeyVal> a(n), b(n);
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        const Cooef *src = parts[p];
+        KeyVal *dst = a.data() + partStart[p];
+#pragma omp parallel for
+        for (long k = 0; k < (long)sizes[p]; ++k)
+        {
+            dst[k].key = (uint64_t)src[k].i * cols + src[k].j;
+            dst[k].val = src[k].val;
+        }
+    }
+
+    // 1. LSD基数排序
+    uint64_t maxKey = (uint64_t)rows * cols;
+    int bits = 0;
+    while (bits < 64 && (maxKey >> bits) > 0)
+    {
+        ++bits;
+    }
+    int nt = omp_get_max_threads();
+    std::vector<size_t> hist((size_t)nt * RADIX);
+    for (int shift = 0; shift < bits; shift += RADIX_BITS)
+    {
+        std::fill(hist.begin(), hist.end(), 0);
+#pragma omp parallel num_threads(nt)
+        {
+            int t = omp_get_thread_num();
+            size_t lo = n * t / nt, hi = n * (t + 1) / nt;
+            size_t *h = hist.data() + (size_t)t * RADIX;
+            for (size_t k = lo; k < hi; ++k)
+            {
+                h[(a[k].key >> shift) & (RADIX - 1)]++;
+            }
+#pragma omp barrier
+#pragma omp single
+            {
+                // 按(桶, 线程)的顺序做前缀和, 保证稳定
+                size_t sum = 0;
+                for (int d = 0; d < RADIX; ++d)
+                {
+                    for (int s = 0; s < nt; ++s)
+                    {
+                        size_t c = hist[(size_t)s * RADIX + d];
+                        hist[(size_t)s * RADIX + d] = sum;
+                        sum += c;
+                    }
+                }
+            }
+            for (size_t k = lo; k < hi; ++k)
+            {
+                b[h[(a[k].key >> shift) & (RADIX - 1)]++] = a[k];
+            }
+        }
+        a.swap(b);
+    }
+
+    // 2. 分段归约
+    std::vector<size_t> heads(nt + 1, 0);
+#pragma omp parallel num_threads(nt)
+    {
+        int t = omp_get_thread_num();
+        size_t lo = n * t / nt, hi = n * (t + 1) / nt;
+        size_t c = 0;
+        for (size_t k = lo; k < hi; ++k)
+        {
+            c += (k == 0 || a[k].key != a[k - 1].key);
+        }
+        heads[t + 1] = c;
+#pragma omp barrier
+#pragma omp single
+        for (int s = 0; s < nt; ++s)
+        {
+            heads[s + 1] += heads[s];
+        }
+
+        size_t out = heads[t];
+        for (size_t k = lo; k < hi; ++k)
+        {
+            if (k != 0 && a[k].key == a[k - 1].key)
+                continue;
+            double sum = a[k].val;
+            size_t m = k + 1;
+            while (m < n && a[m].key == a[k].key)
+            {
+                sum += a[m].val;
+                ++m;
+            }
+            b[out].key = a[k].key;
+            b[out].val = sum;
+            ++out;
+        }
+    }
+    size_t nnz = heads[nt];
+
+    // 3. 写入CSR
+    A.rows = rows;
+    A.cols = cols;
+    A.row_offset.resize(rows + 1);
+    A.elm_idx.resize(nnz);
+    A.elements.resize(nnz);
+#pragma omp parallel for
+    for (long k = 0; k < (long)nnz; ++k)
+    {
+        uint64_t key = b[k].key;
+        long r = key / cols;
+        A.elm_idx[k] = key % cols;
+        A.elements[k] = b[k].val;
+        long prev = (k == 0) ? -1 : (long)(b[k - 1].key / cols);
+        for (long rr = prev + 1; rr <= r; ++rr)
+        {
+            A.row_offset[rr] = k;
+        }
+    }
+    long last = (nnz == 0) ? -1 : (long)(b[nnz - 1].key / cols);
+    for (long rr = last + 1; rr <= rows; ++rr)
+    {
+        A.row_offset[rr] = nnz;
+    }
+}
+
+NAMESPACE_END
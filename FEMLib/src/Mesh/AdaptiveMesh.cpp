@@ -0,0 +1,452 @@
+#include <AdaptiveMesh.h>
+#include <TripletAssembler.h>
+#include <fem.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static inline uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+}
+
+AdaptiveMesh::AdaptiveMesh(const Mesh &initial, bool sphere, int maxLevel)
+    : sphere(sphere), maxLevel(maxLevel)
+{
+    int n = initial.vertex_count();
+    points.assign(initial.vertices.begin(), initial.vertices.end());
+    pointParent.assign(2 * n, -1);
+    alive.assign(n, 1);
+
+    // 以最长边为加密边, 轮换顶点的顺序使加密边为 v0-v1, 方向不变
+    for (size_t t = 0; t < initial.triangle_count(); ++t)
+    {
+        uint32_t v[3] = {initial.indices[3 * t], initial.indices[3 * t + 1], initial.indices[3 * t + 2]};
+        int longest = 0;
+        double len = -1;
+        for (int k = 0; k < 3; ++k)
+        {
+            double l = norm2(points[v[(k + 1) % 3]] - points[v[k]]);
+            if (l > len)
+            {
+                len = l;
+                longest = k;
+            }
+        }
+        roots.push_back(newElement(v[longest], v[(longest + 1) % 3], v[(longest + 2) % 3], -1));
+    }
+    rebuild();
+    prevVertexToId = vertexToId;
+}
+
+int AdaptiveMesh::newElement(uint32_t v0, uint32_t v1, uint32_t v2, int parent)
+{
+    Element e;
+    e.v[0] = v0;
+    e.v[1] = v1;
+    e.v[2] = v2;
+    e.parent = parent;
+    e.child[0] = e.child[1] = -1;
+    e.midpoint = -1;
+    e.bisected = 0;
+    e.level = parent < 0 ? 0 : elements[parent].level + 1;
+    massLoc(points[v1] - points[v0], points[v2] - points[v0], e.Mloc);
+    stiffLoc(points[v1] - points[v0], points[v2] - points[v0], e.Sloc);
+    elements.push_back(e);
+    return elements.size() - 1;
+}
+
+int AdaptiveMesh::newPoint(int a, int b)
+{
+    Vec3 p = 0.5 * (points[a] + points[b]);
+    points.push_back(sphere ? normalized(p) : p);
+    pointParent.push_back(a);
+    pointParent.push_back(b);
+    alive.push_back(1);
+    return points.size() - 1;
+}
+
+void AdaptiveMesh::bisect(int e, std::unordered_map<uint64_t, int> &edges)
+{
+    uint32_t a = elements[e].v[0], b = elements[e].v[1], c = elements[e].v[2];
+    auto it = edges.find(edgeKey(a, b));
+    if (it == edges.end())
+        return;
+    // 粗化时保留的子三角形与中点: 这条边还没有中点时直接恢复
+    bool retained = elements[e].child[0] >= 0;
+    if (it->second < 0)
+    {
+        if (retained)
+        {
+            it->second = elements[e].midpoint;
+            alive[it->second] = 1;
+        }
+        else
+        {
+            it->second = newPoint(a, b);
+        }
+    }
+    int m = it->second;
+
+    int c0, c1;
+    if (retained && elements[e].midpoint == m)
+    {
+        c0 = elements[e].child[0];
+        c1 = elements[e].child[1];
+    }
+    else
+    {
+        // elements可能重新分配, 不能保存引用
+        c0 = newElement(c, a, m, e);
+        c1 = newElement(b, c, m, e);
+        elements[e].child[0] = c0;
+        elements[e].child[1] = c1;
+        elements[e].midpoint = m;
+    }
+    elements[e].bisected = 1;
+    bisect(c0, edges);
+    bisect(c1, edges);
+}
+
+void AdaptiveMesh::collectLeaves()
+{
+    // 二分树的深度优先顺序, 相邻的三角形在空间上也相近
+    leaves.clear();
+    std::vector<int> stack;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+    {
+        stack.push_back(*it);
+    }
+    while (!stack.empty())
+    {
+        int e = stack.back();
+        stack.pop_back();
+        if (!elements[e].bisected)
+        {
+            leaves.push_back(e);
+        }
+        else
+        {
+            stack.push_back(elements[e].child[1]);
+            stack.push_back(elements[e].child[0]);
+        }
+    }
+}
+
+void AdaptiveMesh::compact()
+{
+    // 当前的二分树按深度优先顺序重新编号, 父三角形在子三角形之前, 不在树中的保留三角形被丢弃
+    std::vector<int> elementId(elements.size(), -1);
+    std::vector<Element> kept;
+    kept.reserve(2 * leaves.size());
+    std::vector<int> stack;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+    {
+        stack.push_back(*it);
+    }
+    while (!stack.empty())
+    {
+        int e = stack.back();
+        stack.pop_back();
+        elementId[e] = kept.size();
+        kept.push_back(elements[e]);
+        if (elements[e].bisected)
+        {
+            stack.push_back(elements[e].child[1]);
+            stack.push_back(elements[e].child[0]);
+        }
+    }
+
+    // 存活的点按id的顺序重新编号, 新的点的两个端点的id仍然更小
+    std::vector<int> newId(points.size(), -1);
+    int nv = 0;
+    for (size_t id = 0; id < points.size(); ++id)
+    {
+        if (alive[id])
+        {
+            newId[id] = nv;
+            points[nv] = points[id];
+            pointParent[2 * nv] = pointParent[2 * id] < 0 ? -1 : newId[pointParent[2 * id]];
+            pointParent[2 * nv + 1] = pointParent[2 * id + 1] < 0 ? -1 : newId[pointParent[2 * id + 1]];
+            ++nv;
+        }
+    }
+    points.resize(nv);
+    pointParent.resize(2 * nv);
+    alive.assign(nv, 1);
+
+    for (Element &e : kept)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            e.v[k] = newId[e.v[k]];
+        }
+        if (e.parent >= 0)
+        {
+            e.parent = elementId[e.parent];
+        }
+        if (e.bisected)
+        {
+            e.child[0] = elementId[e.child[0]];
+            e.child[1] = elementId[e.child[1]];
+            e.midpoint = newId[e.midpoint];
+        }
+        else
+        {
+            e.child[0] = e.child[1] = -1;
+            e.midpoint = -1;
+        }
+    }
+    elements.swap(kept);
+    for (int &r : roots)
+    {
+        r = elementId[r];
+    }
+
+    // 网格本身不变, 只更新编号
+    for (int &id : vertexToId)
+    {
+        id = newId[id];
+    }
+    idToVertex.assign(nv, -1);
+    for (size_t v = 0; v < vertexToId.size(); ++v)
+    {
+        idToVertex[vertexToId[v]] = v;
+    }
+    collectLeaves();
+}
+
+void AdaptiveMesh::rebuild()
+{
+    collectLeaves();
+    idToVertex.assign(points.size(), -1);
+    vertexToId.clear();
+    for (size_t id = 0; id < points.size(); ++id)
+    {
+        if (alive[id])
+        {
+            idToVertex[id] = vertexToId.size();
+            vertexToId.push_back(id);
+        }
+    }
+
+    int nv = vertexToId.size();
+    int nt = leaves.size();
+    mesh.meshtype = CUSTOM;
+    mesh.subdiv = 0;
+    mesh.vertices.resize(nv);
+    mesh.indices.resize(3 * nt);
+#pragma omp parallel for
+    for (int v = 0; v < nv; ++v)
+    {
+        mesh.vertices[v] = points[vertexToId[v]];
+    }
+#pragma omp parallel for
+    for (int t = 0; t < nt; ++t)
+    {
+        const Element &e = elements[leaves[t]];
+        for (int k = 0; k < 3; ++k)
+        {
+            mesh.indices[3 * t + k] = idToVertex[e.v[k]];
+        }
+    }
+}
+
+void AdaptiveMesh::indicator(const Vec &u, Vec &eta) const
+{
+    int nt = leaves.size();
+    eta.resize(nt);
+#pragma omp parallel for
+    for (int t = 0; t < nt; ++t)
+    {
+        double a = u[mesh.indices[3 * t]], b = u[mesh.indices[3 * t + 1]], c = u[mesh.indices[3 * t + 2]];
+        eta[t] = std::max({a, b, c}) - std::min({a, b, c});
+    }
+}
+
+void AdaptiveMesh::mark(const Vec &eta, double refineFraction, double coarsenFraction, std::vector<char> &refine, std::vector<char> &coarsen) const
+{
+    int nt = leaves.size();
+    double etaMax = 0;
+#pragma omp parallel for reduction(max : etaMax)
+    for (int t = 0; t < nt; ++t)
+    {
+        etaMax = std::max(etaMax, eta[t]);
+    }
+    refine.assign(nt, 0);
+    coarsen.assign(nt, 0);
+#pragma omp parallel for
+    for (int t = 0; t < nt; ++t)
+    {
+        refine[t] = eta[t] > refineFraction * etaMax && elements[leaves[t]].level < maxLevel;
+        coarsen[t] = eta[t] < coarsenFraction * etaMax;
+    }
+}
+
+int AdaptiveMesh::adapt(const std::vector<char> &refine, const std::vector<char> &coarsen)
+{
+    if ((int)refine.size() != numTriangles() || (int)coarsen.size() != numTriangles())
+    {
+        throw std::invalid_argument("AdaptiveMesh: the marks do not match the mesh.");
+    }
+    // 删除的点与保留的三角形过多时先压缩, 使各个数组的大小与当前网格成正比
+    if (points.size() > 2 * vertexToId.size() || elements.size() > 4 * leaves.size())
+    {
+        compact();
+    }
+    prevVertexToId = vertexToId;
+    int before = numVertices();
+    int nt = leaves.size();
+
+    /* 粗化: 包含点m的三角形都以m为最新的顶点, 都被标记粗化, 并且父三角形以m二分, 两个子三角形都是叶子
+     * 每个三角形只有一个最新的顶点, 不同的m涉及的三角形互不相交, 可以同时粗化
+     */
+    std::vector<int> offset(points.size() + 1, 0);
+    for (int t = 0; t < nt; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            offset[elements[leaves[t]].v[k] + 1]++;
+    }
+    for (size_t id = 0; id < points.size(); ++id)
+    {
+        offset[id + 1] += offset[id];
+    }
+    std::vector<int> around(offset.back()), fill(offset.begin(), offset.end() - 1);
+    for (int t = 0; t < nt; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            around[fill[elements[leaves[t]].v[k]]++] = t;
+    }
+
+    std::vector<char> leafRefine(elements.size(), 0);
+    for (int t = 0; t < nt; ++t)
+    {
+        leafRefine[leaves[t]] = refine[t];
+    }
+
+    std::vector<int> removable;
+    for (int t = 0; t < nt; ++t)
+    {
+        if (!coarsen[t] || refine[t])
+            continue;
+        int m = elements[leaves[t]].v[2];
+        if (pointParent[2 * m] < 0 || !alive[m])
+            continue;
+        bool ok = true;
+        for (int q = offset[m]; q < offset[m + 1] && ok; ++q)
+        {
+            int s = around[q];
+            const Element &e = elements[leaves[s]];
+            ok = coarsen[s] && !refine[s] && e.v[2] == (uint32_t)m && e.parent >= 0;
+            if (ok)
+            {
+                const Element &p = elements[e.parent];
+                ok = p.midpoint == m && !elements[p.child[0]].bisected && !elements[p.child[1]].bisected;
+            }
+        }
+        // 只由包含m的第一个三角形处理, 避免重复
+        if (ok && around[offset[m]] == t)
+            removable.push_back(m);
+    }
+    for (int m : removable)
+    {
+        // 子三角形与中点保留, 同一条边再次二分时重新使用
+        for (int q = offset[m]; q < offset[m + 1]; ++q)
+        {
+            elements[elements[leaves[around[q]]].parent].bisected = 0;
+        }
+        alive[m] = 0;
+    }
+
+    /* 加密: 被标记的(仍然是叶子的)三角形的加密边, 以及闭包
+     * 一个叶子有边需要二分时, 它的加密边也需要二分
+     */
+    collectLeaves();
+
+    std::unordered_map<uint64_t, int> edges;
+    for (int e : leaves)
+    {
+        if (leafRefine[e])
+            edges.emplace(edgeKey(elements[e].v[0], elements[e].v[1]), -1);
+    }
+    bool changed = !edges.empty();
+    while (changed)
+    {
+        changed = false;
+        for (int e : leaves)
+        {
+            const uint32_t *v = elements[e].v;
+            if (edges.count(edgeKey(v[0], v[1])))
+                continue;
+            if (edges.count(edgeKey(v[1], v[2])) || edges.count(edgeKey(v[2], v[0])))
+            {
+                edges.emplace(edgeKey(v[0], v[1]), -1);
+                changed = true;
+            }
+        }
+    }
+    // bisect会增加elements但不改变leaves
+    for (int e : leaves)
+    {
+        bisect(e, edges);
+    }
+
+    rebuild();
+    return numVertices() - before;
+}
+
+void AdaptiveMesh::transfer(const Vec &oldField, Vec &newField) const
+{
+    // 按id的顺序计算, 新的点的两个端点的id更小, 已经得到了值
+    std::vector<double> value(points.size(), 0.0);
+    std::vector<char> known(points.size(), 0);
+    for (size_t v = 0; v < prevVertexToId.size(); ++v)
+    {
+        value[prevVertexToId[v]] = oldField[v];
+        known[prevVertexToId[v]] = 1;
+    }
+    for (size_t id = 0; id < points.size(); ++id)
+    {
+        if (!known[id] && alive[id])
+        {
+            value[id] = 0.5 * (value[pointParent[2 * id]] + value[pointParent[2 * id + 1]]);
+            known[id] = 1;
+        }
+    }
+    int nv = vertexToId.size();
+    newField.resize(nv);
+#pragma omp parallel for
+    for (int v = 0; v < nv; ++v)
+    {
+        newField[v] = value[vertexToId[v]];
+    }
+}
+
+void AdaptiveMesh::assemble(CSRMatrix &M, CSRMatrix &S) const
+{
+    int n = numVertices();
+    int nt = numTriangles();
+    TripletAssembler massAssembler(n, n), stiffAssembler(n, n);
+    massAssembler.reserve(9 * nt / massAssembler.buffers.size() + 16);
+    stiffAssembler.reserve(9 * nt / stiffAssembler.buffers.size() + 16);
+#pragma omp parallel for
+    for (int t = 0; t < nt; ++t)
+    {
+        const Element &e = elements[leaves[t]];
+        uint32_t v[3] = {mesh.indices[3 * t], mesh.indices[3 * t + 1], mesh.indices[3 * t + 2]};
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                massAssembler.add(v[i], v[j], i == j ? e.Mloc[0] : e.Mloc[1]);
+                stiffAssembler.add(v[i], v[j], i == j ? e.Sloc[i] : e.Sloc[i + j + 2]); // (0, 1), (0, 2), (1, 2) 对应 Sloc[3], Sloc[4], Sloc[5]
+            }
+        }
+    }
+    massAssembler.assemble(M);
+    stiffAssembler.assemble(S);
+}
+
+NAMESPACE_END
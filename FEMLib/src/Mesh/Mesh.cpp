@@ -2,349 +2,369 @@
 #include <TArray.h>
 #include <vec3.h>
 #include <cstdint>
-// #include <timer.h>
-// #include <iostream>
-#include <unordered_map>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
 
 NAMESPACE_BEGIN(FEMLib)
 
 /* 生成立方体网格, 中心为原点，边长为2
  * 对于有n个子分割的网格
  * 正方体网格中有6n^2+2个顶点, 12n^2个三角形
- * 1. 生成顶点，同时使用hash表记录每个顶点的对应下标，生成一个不包含重复点的顶点集合 vertex_index_map
- * 2. 同时生成一个有重复点时下标与无重复点时下标的hash表 dupToNoDupIndex
- * 3. 根据dupToNoDupIndex创建三角形
+ * 六个面依次编号, 每个面上按(i, j)逐行编号, 共有6(n+1)^2个重复的点
+ * 不重复的点按首次出现的顺序编号, 这一编号可以直接算出, 不需要hash表:
+ * 1. 一个点第一次出现在包含它的编号最小的面上(owner)
+ * 2. 面f上首次出现的点是去掉与之前的面共用的边界行和列之后剩下的矩形, 在矩形中逐行编号, 面f的起始编号为之前各面矩形大小之和
+ * 因此每个重复点的不重复编号只依赖(face, i, j), 顶点、dupToNoDupIndex和三角形都可以并行生成
  */
 
-int load_cube(Mesh &m, const int subdiv)
+struct CubeFace
+{
+    int axis;      // 0:x, 1:y, 2:z
+    int dir;       // 0:负方向, 1:正方向
+    int firstAxis; // 当前面进行编号的坐标轴顺序，以保持三角形的方向性, j对应firstAxis, i对应lastAxis
+    int lastAxis;
+
+    // 在这个面上首次出现的点为 [i0, i1] x [j0, j1], 编号从base开始
+    int i0, i1, j0, j1;
+    int base;
+};
+
+static const int CUBE_FACE_AXES[6][4] = {{0, 1, 1, 2},
+                                         {1, 1, 0, 2},
+                                         {0, 0, 1, 2},
+                                         {1, 0, 0, 2},
+                                         {2, 1, 1, 0},
+                                         {2, 0, 1, 0}};
+
+static void buildCubeFaces(int subdiv, CubeFace faces[6])
+{
+    int base = 0;
+    for (int f = 0; f < 6; ++f)
+    {
+        CubeFace &face = faces[f];
+        face.axis = CUBE_FACE_AXES[f][0];
+        face.dir = CUBE_FACE_AXES[f][1];
+        face.firstAxis = CUBE_FACE_AXES[f][2];
+        face.lastAxis = CUBE_FACE_AXES[f][3];
+        face.i0 = 0, face.i1 = subdiv;
+        face.j0 = 0, face.j1 = subdiv;
+        for (int g = 0; g < f; ++g)
+        {
+            // 之前的面垂直于lastAxis时去掉一行, 垂直于firstAxis时去掉一列
+            const CubeFace &prev = faces[g];
+            if (prev.axis == face.lastAxis)
+            {
+                if (prev.dir)
+                    face.i1 = subdiv - 1;
+                else
+                    face.i0 = 1;
+            }
+            else if (prev.axis == face.firstAxis)
+            {
+                if (prev.dir)
+                    face.j1 = subdiv - 1;
+                else
+                    face.j0 = 1;
+            }
+        }
+        face.base = base;
+        base += (face.i1 - face.i0 + 1) * (face.j1 - face.j0 + 1);
+    }
+}
+
+static inline int cubeVertexIndex(const CubeFace faces[6], int subdiv, int f, int i, int j, int coords[3])
+// 面f上(i, j)处的点的不重复编号, 同时在coords中给出整数坐标
+{
+    const CubeFace &face = faces[f];
+    coords[face.axis] = face.dir * subdiv;
+    coords[face.firstAxis] = j;
+    coords[face.lastAxis] = i;
+    if (i > 0 && i < subdiv && j > 0 && j < subdiv)
+    {
+        // 面的内部只属于这个面
+        return face.base + (i - face.i0) * (face.j1 - face.j0 + 1) + (j - face.j0);
+    }
+    for (int g = 0; g <= f; ++g)
+    {
+        const CubeFace &owner = faces[g];
+        if (coords[owner.axis] == owner.dir * subdiv)
+        {
+            int oi = coords[owner.lastAxis] - owner.i0;
+            int oj = coords[owner.firstAxis] - owner.j0;
+            return owner.base + oi * (owner.j1 - owner.j0 + 1) + oj;
+        }
+    }
+    return -1; // 不会到达, 面f本身总是包含这个点
+}
+
+int load_cube(Mesh &m, const int subdiv, int *dupToNoDupIndex)
 {
     m.meshtype = CUBE;
     m.subdiv = subdiv;
-    // Timer timer;
-    // timer.start();
 
     int n = subdiv + 1;
+    CubeFace faces[6];
+    buildCubeFaces(subdiv, faces);
 
-    struct Face
-    {
-        int axis;      // 0:x, 1:y, 2:z
-        int dir;       // 0:负方向, 1:正方向
-        int firstAxis; // 当前面进行编号的坐标轴顺序，以保持三角形的方向性
-        int lastAxis;
-    };
-
-    std::vector<Face> faces = {{0, 1, 1, 2},
-                               {1, 1, 0, 2},
-                               {0, 0, 1, 2},
-                               {1, 0, 0, 2},
-                               {2, 1, 1, 0},
-                               {2, 0, 1, 0}};
-
-    int totalVertices = 6 * n * n;                // 重复顶点有6n^2个
-    int uniqueVertices = 6 * subdiv * subdiv + 2; // 不重复的顶点有6 * subdiv^2 + 2个
-
-    // 使用一个hash函数将Vec3映射到int64, 避免使用Vec3作为主键
-    std::unordered_map<int64_t, int> vertex_index_map;
-    vertex_index_map.reserve(uniqueVertices);
+    size_t uniqueVertices = 6 * (size_t)subdiv * subdiv + 2; // 不重复的顶点有6 * subdiv^2 + 2个
     m.vertices.resize(uniqueVertices);
-
-    // 从重复点索引到不重复点索引的map
-    int *dupToNoDupIndex = new int[totalVertices];
-
-    int t = 0; // t 表示存在重复点的下标
-    int p = 0; // p 表示不重复点的下标
+    m.indices.resize(36 * (size_t)subdiv * subdiv); // 共计12n^2个三角形, 36n^2个顶点
 
     double invSubdiv = 1.0 / (double)subdiv; // 提前计算好减少浮点数除法
 
-    for (const Face &face : faces)
+    // 生成顶点与dupToNoDupIndex, 每个点只由它的owner写入
+#pragma omp parallel for
+    for (int fi = 0; fi < 6 * n; ++fi)
     {
-        int axis = face.axis;
-        int dir = face.dir;
-
-        int idx1 = face.firstAxis;
-        int idx2 = face.lastAxis;
-
-        for (int i = 0; i < n; ++i)
+        int f = fi / n;
+        int i = fi % n;
+        for (int j = 0; j < n; ++j)
         {
-            for (int j = 0; j < n; ++j)
+            int coords[3];
+            int p = cubeVertexIndex(faces, subdiv, f, i, j, coords);
+            if (dupToNoDupIndex)
             {
-                /* 先使用整数坐标表示一个点，方便后续使用hash
-                 * 例如face = {0, 1}, 即表示垂直于x轴，位于正半轴区域的面
-                 * axis = 0, dir = 1, idx1 = 1, idx2 = 2
-                 * 经过处理后coords存储的是 [subdiv, i, j] 这样的点
-                 * 之后经过处理可以变成需要的范围
-                 */
-                int coords[3] = {0, 0, 0};
-                coords[axis] = dir * subdiv;
-
-                coords[idx1] = j; // 此处firstAxis上的先编号
-                coords[idx2] = i;
-
-                /* Hash函数的部分
-                 * 将三个坐标映射到int64的范围中作为主键
-                 * 需要subdiv < 2^20
-                 */
-                int64_t key = (int64_t)coords[0] | (int64_t)coords[1] << 20 | (int64_t)coords[2] << 40;
-
-                auto it = vertex_index_map.find(key);
-                if (it == vertex_index_map.end()) // 若这个点是首次出现
-                {
-                    vertex_index_map[key] = p; // 存储这个点的位置为p
-                    dupToNoDupIndex[t] = p;
-
-                    // 计算顶点的位置
-                    double fx = coords[0] * invSubdiv * 2.0 - 1.0;
-                    double fy = coords[1] * invSubdiv * 2.0 - 1.0;
-                    double fz = coords[2] * invSubdiv * 2.0 - 1.0;
-
-                    m.vertices[p] = {fx, fy, fz};
-
-                    ++p;
-                }
-                else
-                {
-                    dupToNoDupIndex[t] = it->second; // 将重复点的下标对应到不重复点的下标
-                }
-
-                ++t;
+                dupToNoDupIndex[(size_t)fi * n + j] = p;
+            }
+            const CubeFace &face = faces[f];
+            if (i >= face.i0 && i <= face.i1 && j >= face.j0 && j <= face.j1)
+            {
+                double fx = coords[0] * invSubdiv * 2.0 - 1.0;
+                double fy = coords[1] * invSubdiv * 2.0 - 1.0;
+                double fz = coords[2] * invSubdiv * 2.0 - 1.0;
+                m.vertices[p] = {fx, fy, fz};
             }
         }
     }
-    // timer.stop();
 
-    // std::cout << "生成网格用时: " << timer.elapsedMilliseconds() << "ms\n";
-
-    // timer.start();
-    //  生成三角形
-    m.indices.resize(36 * subdiv * subdiv); // 共计12n^2个三角形, 36n^2个顶点
-
-    t = 0;
-    int faceVertexOffset = 0;
-    for (int faceIdx = 0; faceIdx < 6; ++faceIdx)
+    // 生成三角形, 每个面上的第i行四边形写入固定的位置
+#pragma omp parallel for
+    for (int fi = 0; fi < 6 * subdiv; ++fi)
     {
-        for (int i = 0; i < subdiv; ++i)
+        int faceIdx = fi / subdiv;
+        int i = fi % subdiv;
+        size_t t = (size_t)fi * subdiv * 6;
+        int coords[3];
+        for (int j = 0; j < subdiv; ++j)
         {
-            for (int j = 0; j < subdiv; ++j)
+            int v0 = cubeVertexIndex(faces, subdiv, faceIdx, i, j, coords);         // 左下的点
+            int v1 = cubeVertexIndex(faces, subdiv, faceIdx, i, j + 1, coords);     // 右下
+            int v2 = cubeVertexIndex(faces, subdiv, faceIdx, i + 1, j, coords);     // 左上
+            int v3 = cubeVertexIndex(faces, subdiv, faceIdx, i + 1, j + 1, coords); // 右上
+
+            if (faceIdx == 1 || faceIdx == 2 || faceIdx == 4)
             {
-                int idx0 = faceVertexOffset + i * n + j;           // 左下的点
-                int idx1 = faceVertexOffset + i * n + j + 1;       // 右下
-                int idx2 = faceVertexOffset + (i + 1) * n + j;     // 左上
-                int idx3 = faceVertexOffset + (i + 1) * n + j + 1; // 右上
-
-                int v0 = dupToNoDupIndex[idx0];
-                int v1 = dupToNoDupIndex[idx1];
-                int v2 = dupToNoDupIndex[idx2];
-                int v3 = dupToNoDupIndex[idx3];
-
-                if (faceIdx == 1 || faceIdx == 2 || faceIdx == 4)
-                {
-                    m.indices[t++] = v1;
-                    m.indices[t++] = v0;
-                    m.indices[t++] = v3;
-                    m.indices[t++] = v0;
-                    m.indices[t++] = v2;
-                    m.indices[t++] = v3;
-                }
-                else
-                {
-                    m.indices[t++] = v0;
-                    m.indices[t++] = v1;
-                    m.indices[t++] = v2;
-                    m.indices[t++] = v1;
-                    m.indices[t++] = v3;
-                    m.indices[t++] = v2;
-                }
+                m.indices[t++] = v1;
+                m.indices[t++] = v0;
+                m.indices[t++] = v3;
+                m.indices[t++] = v0;
+                m.indices[t++] = v2;
+                m.indices[t++] = v3;
+            }
+            else
+            {
+                m.indices[t++] = v0;
+                m.indices[t++] = v1;
+                m.indices[t++] = v2;
+                m.indices[t++] = v1;
+                m.indices[t++] = v3;
+                m.indices[t++] = v2;
             }
         }
-
-        faceVertexOffset += n * n;
     }
 
-    delete[] dupToNoDupIndex;
-    // timer.stop();
-
-    // std::cout << "生成三角形用时: " << timer.elapsedMilliseconds() << "ms\n";
-
     return 0;
 }
 
-int load_sphere(Mesh &m, int subdiv)
+int load_sphere(Mesh &m, const int subdiv, int *dupToNoDupIndex)
 {
-    load_cube(m, subdiv);
+    load_cube(m, subdiv, dupToNoDupIndex);
     m.meshtype = SPHERE;
 
-    // Timer t;
-    // t.start();
-    for (size_t i = 0; i < m.vertex_count(); ++i)
+#pragma omp parallel for
+    for (long i = 0; i < (long)m.vertex_count(); ++i)
     {
         m.vertices[i] = normalized(m.vertices[i]);
     }
-    // t.stop();
-    // std::cout << "生成球面用时: " << t.elapsedMilliseconds() << "ms" << std::endl;
     return 0;
 }
 
-int load_cube(Mesh &m, const int subdiv, int *dupToNoDupIndex)
+/* 等角立方球面
+ * 直接投影时立方体面上等距的点在球面上的角度间隔不均匀, 角点附近的三角形面积只有面中心的约1/5, 且形状扭曲
+ * 把面上的坐标 x 换成 tan(pi/4 * x) 后再投影, 面上等距的点对应相等的中心角
+ * 面的法向坐标为+-1, tan(+-pi/4) = +-1, 因此三个坐标可以统一处理
+ */
+int load_equiangular_sphere(Mesh &m, const int subdiv, int *dupToNoDupIndex)
 {
-    m.meshtype = CUBE;
-    m.subdiv = subdiv;
-    // Timer timer;
-    // timer.start();
-
-    int n = subdiv + 1;
+    load_cube(m, subdiv, dupToNoDupIndex);
+    m.meshtype = EQUIANGULAR_SPHERE;
 
-    struct Face
+    const double quarterPi = std::atan(1.0);
+#pragma omp parallel for
+    for (long i = 0; i < (long)m.vertex_count(); ++i)
     {
-        int axis;      // 0:x, 1:y, 2:z
-        int dir;       // 0:负方向, 1:正方向
-        int firstAxis; // 当前面进行编号的坐标轴顺序，以保持三角形的方向性
-        int lastAxis;
-    };
-
-    std::vector<Face> faces = {{0, 1, 1, 2},
-                               {1, 1, 0, 2},
-                               {0, 0, 1, 2},
-                               {1, 0, 0, 2},
-                               {2, 1, 1, 0},
-                               {2, 0, 1, 0}};
-
-    int totalVertices = 6 * n * n;                // 重复顶点有6n^2个
-    int uniqueVertices = 6 * subdiv * subdiv + 2; // 不重复的顶点有6 * subdiv^2 + 2个
-
-    // 使用一个hash函数将Vec3映射到int64, 避免使用Vec3作为主键
-    std::unordered_map<int64_t, int> vertex_index_map;
-    vertex_index_map.reserve(uniqueVertices);
-    m.vertices.resize(uniqueVertices);
-
-    int t = 0; // t 表示存在重复点的下标
-    int p = 0; // p 表示不重复点的下标
+        Vec3 &v = m.vertices[i];
+        Vec3 t = {std::tan(quarterPi * v[0]), std::tan(quarterPi * v[1]), std::tan(quarterPi * v[2])};
+        v = normalized(t);
+    }
+    return 0;
+}
 
-    double invSubdiv = 1.0 / (double)subdiv; // 提前计算好减少浮点数除法
+/* 二十面体球面
+ * 从正二十面体开始, 每次把每个三角形用三条边的中点分成4个, 新的点投影到球面上
+ * 每一层的边由排序得到唯一的编号, 第e条边的中点编号为 (已有的顶点数 + e), 不需要hash表
+ * 因此前一层的顶点是后一层顶点的前缀, parents记录每个新点所在的边, 多重网格的插值可以直接由parents得到
+ */
+int load_icosphere(Mesh &m, const int subdiv)
+{
+    m.meshtype = ICOSPHERE;
+    m.subdiv = subdiv;
 
-    for (const Face &face : faces)
+    const double a = (1.0 + std::sqrt(5.0)) / 2.0;
+    const double base[12][3] = {{-1, a, 0}, {1, a, 0}, {-1, -a, 0}, {1, -a, 0},
+                                {0, -1, a}, {0, 1, a}, {0, -1, -a}, {0, 1, -a},
+                                {a, 0, -1}, {a, 0, 1}, {-a, 0, -1}, {-a, 0, 1}};
+    // 从外侧看为逆时针
+    const uint32_t baseTri[20][3] = {{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+                                     {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+                                     {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+                                     {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+    size_t finalVertices = 10 * ((size_t)1 << (2 * subdiv)) + 2;
+    m.vertices.resize(finalVertices);
+    m.parents.resize(2 * finalVertices);
+    for (int i = 0; i < 12; ++i)
     {
-        int axis = face.axis;
-        int dir = face.dir;
+        m.vertices[i] = normalized(Vec3{base[i][0], base[i][1], base[i][2]});
+        m.parents[2 * i] = i;
+        m.parents[2 * i + 1] = i;
+    }
+    m.indices.resize(60);
+    std::copy(&baseTri[0][0], &baseTri[0][0] + 60, m.indices.begin());
 
-        int idx1 = face.firstAxis;
-        int idx2 = face.lastAxis;
+    size_t nv = 12;
+    TArray<uint32_t> next;
+    std::vector<uint64_t> edges;
+    for (int level = 0; level < subdiv; ++level)
+    {
+        long nt = m.triangle_count();
 
-        for (int i = 0; i < n; ++i)
+        // 每条边以 (小的端点, 大的端点) 为key, 排序去重后的位置即为边的编号
+        edges.resize(3 * nt);
+#pragma omp parallel for
+        for (long t = 0; t < nt; ++t)
         {
-            for (int j = 0; j < n; ++j)
+            for (int k = 0; k < 3; ++k)
             {
-                /* 先使用整数坐标表示一个点，方便后续使用hash
-                 * 例如face = {0, 1}, 即表示垂直于x轴，位于正半轴区域的面
-                 * axis = 0, dir = 1, idx1 = 1, idx2 = 2
-                 * 经过处理后coords存储的是 [subdiv, i, j] 这样的点
-                 * 之后经过处理可以变成需要的范围
-                 */
-                int coords[3] = {0, 0, 0};
-                coords[axis] = dir * subdiv;
-
-                coords[idx1] = j;
-                coords[idx2] = i;
-
-                /* Hash函数的部分
-                 * 将三个坐标映射到int64的范围中作为主键
-                 * 需要subdiv < 2^20
-                 */
-                int64_t key = (int64_t)coords[0] | (int64_t)coords[1] << 20 | (int64_t)coords[2] << 40;
-
-                auto it = vertex_index_map.find(key);
-                if (it == vertex_index_map.end()) // 若这个点是首次出现
-                {
-                    vertex_index_map[key] = p; // 存储这个点的位置为p
-                    dupToNoDupIndex[t] = p;
-
-                    // 计算顶点的位置
-                    double fx = coords[0] * invSubdiv * 2.0 - 1.0;
-                    double fy = coords[1] * invSubdiv * 2.0 - 1.0;
-                    double fz = coords[2] * invSubdiv * 2.0 - 1.0;
-
-                    m.vertices[p] = {fx, fy, fz};
-
-                    ++p;
-                }
-                else
-                {
-                    dupToNoDupIndex[t] = it->second; // 将重复点的下标对应到不重复点的下标
-                }
-
-                ++t;
+                uint64_t u = m.indices[3 * t + k], v = m.indices[3 * t + (k + 1) % 3];
+                edges[3 * t + k] = (std::min(u, v) << 32) | std::max(u, v);
             }
         }
-    }
-    // timer.stop();
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        long ne = edges.size();
 
-    // std::cout << "生成网格用时: " << timer.elapsedMilliseconds() << "ms\n";
-
-    // timer.start();
-    //  生成三角形
-    m.indices.resize(36 * subdiv * subdiv); // 共计12n^2个三角形, 36n^2个顶点
+#pragma omp parallel for
+        for (long e = 0; e < ne; ++e)
+        {
+            int u = edges[e] >> 32, v = edges[e] & 0xFFFFFFFF;
+            m.vertices[nv + e] = normalized(m.vertices[u] + m.vertices[v]);
+            m.parents[2 * (nv + e)] = u;
+            m.parents[2 * (nv + e) + 1] = v;
+        }
 
-    t = 0;
-    int faceVertexOffset = 0;
-    for (int faceIdx = 0; faceIdx < 6; ++faceIdx)
-    {
-        for (int i = 0; i < subdiv; ++i)
+        // 每个三角形分成4个, 保持原来的方向
+        next.resize(12 * nt);
+#pragma omp parallel for
+        for (long t = 0; t < nt; ++t)
         {
-            for (int j = 0; j < subdiv; ++j)
+            uint32_t v[3], mid[3];
+            for (int k = 0; k < 3; ++k)
             {
-                int idx0 = faceVertexOffset + i * n + j;           // 左下的点
-                int idx1 = faceVertexOffset + i * n + j + 1;       // 右下
-                int idx2 = faceVertexOffset + (i + 1) * n + j;     // 左上
-                int idx3 = faceVertexOffset + (i + 1) * n + j + 1; // 右上
-
-                int v0 = dupToNoDupIndex[idx0];
-                int v1 = dupToNoDupIndex[idx1];
-                int v2 = dupToNoDupIndex[idx2];
-                int v3 = dupToNoDupIndex[idx3];
-
-                if (faceIdx == 1 || faceIdx == 2 || faceIdx == 4)
-                {
-                    m.indices[t++] = v1;
-                    m.indices[t++] = v0;
-                    m.indices[t++] = v3;
-                    m.indices[t++] = v0;
-                    m.indices[t++] = v2;
-                    m.indices[t++] = v3;
-                }
-                else
-                {
-                    m.indices[t++] = v0;
-                    m.indices[t++] = v1;
-                    m.indices[t++] = v2;
-                    m.indices[t++] = v1;
-                    m.indices[t++] = v3;
-                    m.indices[t++] = v2;
-                }
+                v[k] = m.indices[3 * t + k];
+                uint64_t u = v[k], w = m.indices[3 * t + (k + 1) % 3];
+                uint64_t key = (std::min(u, w) << 32) | std::max(u, w);
+                mid[k] = nv + (std::lower_bound(edges.begin(), edges.end(), key) - edges.begin()); // v[k]与v[k + 1]的中点
             }
+            uint32_t tri[12] = {v[0], mid[0], mid[2],
+                                v[1], mid[1], mid[0],
+                                v[2], mid[2], mid[1],
+                                mid[0], mid[1], mid[2]};
+            std::copy(tri, tri + 12, next.begin() + 12 * t);
         }
-
-        faceVertexOffset += n * n;
+        // TArray没有移动构造, 直接交换存储
+        std::swap(m.indices.data, next.data);
+        std::swap(m.indices.size, next.size);
+        std::swap(m.indices.capacity, next.capacity);
+        nv += ne;
     }
-    // timer.stop();
+    return 0;
+}
 
-    // std::cout << "生成三角形用时: " << timer.elapsedMilliseconds() << "ms\n";
+int load_cube(Mesh &m, const int subdiv)
+{
+    return load_cube(m, subdiv, nullptr);
+}
 
-    return 0;
+int load_sphere(Mesh &m, const int subdiv)
+{
+    return load_sphere(m, subdiv, nullptr);
 }
 
-int load_sphere(Mesh &m, int subdiv, int *dupToNoDupIndex)
+int load_equiangular_sphere(Mesh &m, const int subdiv)
 {
-    load_cube(m, subdiv, dupToNoDupIndex);
-    m.meshtype = SPHERE;
+    return load_equiangular_sphere(m, subdiv, nullptr);
+}
 
-    // Timer t;
-    // t.start();
-    for (size_t i = 0; i < m.vertex_count(); ++i)
+MeshQuality meshQuality(const Mesh &m)
+{
+    const double radToDeg = 45.0 / std::atan(1.0);
+    MeshQuality q = {180.0, 0.0, INFINITY, 0.0, 0.0, INFINITY, 0.0};
+    long nt = m.triangle_count();
+#pragma omp parallel
     {
-        m.vertices[i] = normalized(m.vertices[i]);
+        MeshQuality local = q;
+#pragma omp for nowait
+        for (long t = 0; t < nt; ++t)
+        {
+            Vec3 p[3] = {m.vertices[m.indices[3 * t]], m.vertices[m.indices[3 * t + 1]], m.vertices[m.indices[3 * t + 2]]};
+            double area = 0.5 * norm(cross(p[1] - p[0], p[2] - p[0]));
+            local.minArea = std::min(local.minArea, area);
+            local.maxArea = std::max(local.maxArea, area);
+            for (int k = 0; k < 3; ++k)
+            {
+                Vec3 e1 = p[(k + 1) % 3] - p[k];
+                Vec3 e2 = p[(k + 2) % 3] - p[k];
+                double l1 = norm(e1), l2 = norm(e2);
+                double c = std::max(-1.0, std::min(1.0, dot(e1, e2) / (l1 * l2)));
+                double angle = std::acos(c) * radToDeg;
+                local.minAngle = std::min(local.minAngle, angle);
+                local.maxAngle = std::max(local.maxAngle, angle);
+                local.minEdge = std::min(local.minEdge, l1);
+                local.maxEdge = std::max(local.maxEdge, l1);
+            }
+        }
+#pragma omp critical
+        {
+            q.minAngle = std::min(q.minAngle, local.minAngle);
+            q.maxAngle = std::max(q.maxAngle, local.maxAngle);
+            q.minArea = std::min(q.minArea, local.minArea);
+            q.maxArea = std::max(q.maxArea, local.maxArea);
+            q.minEdge = std::min(q.minEdge, local.minEdge);
+            q.maxEdge = std::max(q.maxEdge, local.maxEdge);
+        }
     }
-    // t.stop();
-    // std::cout << "生成球面用时: " << t.elapsedMilliseconds() << "ms" << std::endl;
-    return 0;
+    q.areaRatio = q.maxArea / q.minArea;
+    return q;
+}
+
+void MeshQuality::print() const
+{
+    std::cout << "角度: [" << minAngle << ", " << maxAngle << "], 面积: [" << minArea << ", " << maxArea << "], 面积比: " << areaRatio
+              << ", 边长: [" << minEdge << ", " << maxEdge << "]" << std::endl;
 }
 
 Mesh::Mesh(int subdiv, MeshType meshtype)
@@ -358,33 +378,50 @@ Mesh::Mesh(int subdiv, MeshType meshtype)
     {
         load_sphere(*this, subdiv);
     }
+    else if (meshtype == EQUIANGULAR_SPHERE)
+    {
+        load_equiangular_sphere(*this, subdiv);
+    }
+    else if (meshtype == ICOSPHERE)
+    {
+        load_icosphere(*this, subdiv);
+    }
 }
 
 Mesh::Mesh(int subdiv, MeshType meshtype, bool saveDTND)
-    : dupToNoDupIndex(new int[6 * (subdiv + 1) * (subdiv + 1)])
+    : dupToNoDupIndex((saveDTND && meshtype != ICOSPHERE) ? new int[6 * (subdiv + 1) * (subdiv + 1)] : nullptr)
 {
-    if (!saveDTND)
+    if (meshtype == CUBE)
     {
-        delete[] dupToNoDupIndex;
-        dupToNoDupIndex = nullptr;
-        if (meshtype == CUBE)
-        {
-            load_cube(*this, subdiv);
-        }
-        else if (meshtype == SPHERE)
-        {
-            load_sphere(*this, subdiv);
-        }
+        load_cube(*this, subdiv, dupToNoDupIndex);
     }
-    else
+    else if (meshtype == SPHERE)
     {
-        if (meshtype == CUBE)
-        {
-            load_cube(*this, subdiv, dupToNoDupIndex);
-        }
-        else if (meshtype == SPHERE)
+        load_sphere(*this, subdiv, dupToNoDupIndex);
+    }
+    else if (meshtype == EQUIANGULAR_SPHERE)
+    {
+        load_equiangular_sphere(*this, subdiv, dupToNoDupIndex);
+    }
+    else if (meshtype == ICOSPHERE)
+    {
+        // 没有重复的点, 层次关系保存在parents中
+        load_icosphere(*this, subdiv);
+    }
+}
+
+Mesh::Mesh(const TArray<Vec3> &vertices, const TArray<uint32_t> &indices)
+    : vertices(vertices), indices(indices), meshtype(CUSTOM), subdiv(0), dupToNoDupIndex(nullptr)
+{
+    if (indices.size % 3 != 0)
+    {
+        throw std::invalid_argument("Mesh: the number of indices must be a multiple of 3.");
+    }
+    for (size_t i = 0; i < indices.size; ++i)
+    {
+        if (indices[i] >= vertices.size)
         {
-            load_sphere(*this, subdiv, dupToNoDupIndex);
+            throw std::invalid_argument("Mesh: triangle index out of range.");
         }
     }
 }
@@ -0,0 +1,353 @@
+#include <amg.h>
+#include <CSRMatrix.h>
+#include <chebyshev.h>
+#include <systemSolve.h>
+#include <TArray.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static const uint64_t MIS_ROOT = 3ULL << 60;
+static const uint64_t MIS_UNDECIDED = 1ULL << 60;
+
+static uint64_t misKey(int i, uint64_t state)
+// (状态, 伪随机优先级, 下标), 不同的点的key一定不同
+{
+    uint32_t h = (uint32_t)i * 2654435761u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dU;
+    h ^= h >> 12;
+    return state | ((uint64_t)(h & 0x1FFFFFFF) << 31) | (uint64_t)i;
+}
+
+void aggregate(const CSRMatrix &A, double theta, std::vector<int> &agg, int *numAgg)
+{
+    int n = A.rows;
+
+    // 对角元素
+    std::vector<double> diag(n, 0.0);
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        for (size_t k = A.row_offset[i]; k < A.row_offset[i + 1]; ++k)
+        {
+            if ((int)A.elm_idx[k] == i)
+                diag[i] = std::abs(A.elements[k]);
+        }
+    }
+
+    // 强连接图, 不包括对角线
+    std::vector<size_t> soff(n + 1, 0);
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        size_t c = 0;
+        for (size_t k = A.row_offset[i]; k < A.row_offset[i + 1]; ++k)
+        {
+            int j = A.elm_idx[k];
+            if (j != i && std::abs(A.elements[k]) >= theta * std::sqrt(diag[i] * diag[j]))
+                ++c;
+        }
+        soff[i + 1] = c;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        soff[i + 1] += soff[i];
+    }
+    std::vector<int> sidx(soff[n]);
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        size_t p = soff[i];
+        for (size_t k = A.row_offset[i]; k < A.row_offset[i + 1]; ++k)
+        {
+            int j = A.elm_idx[k];
+            if (j != i && std::abs(A.elements[k]) >= theta * std::sqrt(diag[i] * diag[j]))
+                sidx[p++] = j;
+        }
+    }
+
+    // MIS-2: 被排除的点key为0, 但仍然传递距离2以内的最大值
+    std::vector<uint64_t> state(n, MIS_UNDECIDED), key(n), m1(n);
+    bool undecided = n > 0;
+    while (undecided)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            key[i] = state[i] ? misKey(i, state[i]) : 0;
+        }
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            uint64_t m = key[i];
+            for (size_t k = soff[i]; k < soff[i + 1]; ++k)
+                m = std::max(m, key[sidx[k]]);
+            m1[i] = m;
+        }
+        undecided = false;
+#pragma omp parallel for reduction(|| : undecided)
+        for (int i = 0; i < n; ++i)
+        {
+            if (state[i] != MIS_UNDECIDED)
+                continue;
+            uint64_t m = m1[i];
+            for (size_t k = soff[i]; k < soff[i + 1]; ++k)
+                m = std::max(m, m1[sidx[k]]);
+            if (m == key[i])
+                state[i] = MIS_ROOT;
+            else if (m >= MIS_ROOT)
+                state[i] = 0;
+            else
+                undecided = true;
+        }
+    }
+
+    // 根的编号
+    agg.assign(n, -1);
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (state[i] == MIS_ROOT)
+            agg[i] = count++;
+    }
+
+    // 1. 与根强连接的点加入根的聚集, 2. 剩下的点加入与其强连接的已分配的点的聚集
+    std::vector<int> agg1(agg);
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        if (agg[i] >= 0)
+            continue;
+        for (size_t k = soff[i]; k < soff[i + 1]; ++k)
+        {
+            int j = sidx[k];
+            if (state[j] == MIS_ROOT && (agg1[i] < 0 || agg[j] < agg1[i]))
+                agg1[i] = agg[j];
+        }
+    }
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        agg[i] = agg1[i];
+        if (agg[i] >= 0)
+            continue;
+        for (size_t k = soff[i]; k < soff[i + 1]; ++k)
+        {
+            int a = agg1[sidx[k]];
+            if (a >= 0 && (agg[i] < 0 || a < agg[i]))
+                agg[i] = a;
+        }
+    }
+
+    // A不对称时强连接图不对称, 可能有点没有被分配, 单独作为一个聚集
+    for (int i = 0; i < n; ++i)
+    {
+        if (agg[i] < 0)
+            agg[i] = count++;
+    }
+    *numAgg = count;
+}
+
+AMG::AMG()
+    : Matrix(0, 0), theta(0.08), coarseSize(500), maxLevels(20), minCoarsening(2.0), maxRowNnz(40.0), preSmooth(2), postSmooth(2), singular(false), tol(1e-6), iterMax(1000), verbose(false), iter(0), relError(0)
+{
+}
+
+void AMG::setup(const CSRMatrix &A, bool singular)
+{
+    if (A.rows != A.cols)
+    {
+        throw std::invalid_argument("AMG: the matrix must be square.");
+    }
+    rows = A.rows;
+    cols = A.cols;
+    this->singular = singular;
+    levels.clear();
+
+    levels.emplace_back(new AMGLevel());
+    levels[0]->A = &A;
+    levels[0]->B = Vec(A.rows, 1.0);
+
+    double th = theta;
+    while (true)
+    {
+        AMGLevel &L = *levels.back();
+        const CSRMatrix &Af = *L.A;
+        int n = Af.rows;
+        L.x = Vec(n, 0.0);
+        L.b = Vec(n, 0.0);
+        L.r = Vec(n, 0.0);
+        L.t = Vec(n, 0.0);
+        L.cheb.attach(Af);
+        L.cheb.smoothRatio = 30.0; // 聚集的粗化比例大, 平滑器需要覆盖更宽的高频区间
+
+        if (n <= coarseSize || numLevels() >= maxLevels)
+            break;
+        if (numLevels() > 1 && (double)Af.row_offset[n] > maxRowNnz * n)
+            break; // 粗层已经较稠密, 继续粗化只会使下一层更稠密
+
+        std::vector<int> agg;
+        int nc;
+        aggregate(Af, th, agg, &nc);
+        if (nc == 0 || nc * minCoarsening > n)
+            break;
+
+        // 试探插值T, 每一行只有一个元素
+        Vec Bc(nc, 0.0);
+        for (int i = 0; i < n; ++i)
+        {
+            Bc[agg[i]] += L.B[i] * L.B[i];
+        }
+        for (int a = 0; a < nc; ++a)
+        {
+            Bc[a] = std::sqrt(Bc[a]);
+        }
+        CSRMatrix T(n, nc);
+        T.elm_idx.resize(n);
+        T.elements.resize(n);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            T.row_offset[i + 1] = i + 1;
+            T.elm_idx[i] = agg[i];
+            T.elements[i] = Bc[agg[i]] > 0 ? L.B[i] / Bc[agg[i]] : 0.0;
+        }
+
+        // P = T - omega D^{-1} A T, T的非零结构包含在AT中
+        double omega = 4.0 / (3.0 * L.cheb.safety * L.cheb.lambdaMax);
+        multiplyMatrix(Af, T, L.P);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            double s = -omega * L.cheb.invDiag[i];
+            for (size_t k = L.P.row_offset[i]; k < L.P.row_offset[i + 1]; ++k)
+            {
+                L.P.elements[k] *= s;
+                if ((int)L.P.elm_idx[k] == agg[i])
+                    L.P.elements[k] += T.elements[i];
+            }
+        }
+        transposeMatrix(L.P, L.R);
+
+        // A_c = R A P
+        CSRMatrix AP(0);
+        multiplyMatrix(Af, L.P, AP);
+        levels.emplace_back(new AMGLevel());
+        AMGLevel &C = *levels.back();
+        multiplyMatrix(L.R, AP, C.Ac);
+        C.A = &C.Ac;
+        C.B = Bc;
+        th *= 0.5;
+    }
+
+    // 最粗一层只分解一次, 每次V循环只做两次三角求解
+    const CSRMatrix &Ac = *levels.back()->A;
+    coarseCholesky.analyze(Ac);
+    coarseCholesky.factorize(Ac, singular ? 1e-10 : 0.0);
+}
+
+void AMG::coarseSolve(const AMGLevel &L) const
+// 最粗一层用setup中的分解求解, 奇异时右端项与解都与B正交化
+{
+    double bb = singular ? dot(L.B, L.B) : 0.0;
+    if (bb > 0)
+    {
+        blas_axpy(-dot(L.b, L.B) / bb, L.B, L.b);
+    }
+    coarseCholesky.solve(L.b, L.x);
+    if (bb > 0)
+    {
+        blas_axpy(-dot(L.x, L.B) / bb, L.B, L.x);
+    }
+}
+
+void AMG::cycle(int k) const
+{
+    const AMGLevel &L = *levels[k];
+    if (k + 1 == numLevels())
+    {
+        coarseSolve(L);
+        return;
+    }
+    const AMGLevel &C = *levels[k + 1];
+
+    L.cheb.smooth(L.b, L.x, preSmooth);
+    L.A->MVP(L.x, L.t);
+    blas_axpby(1.0, L.b, -1.0, L.t, L.r);
+    L.R.MVP(L.r, C.b);
+    C.x.setAll(0.0);
+
+    cycle(k + 1);
+
+    L.P.MVP(C.x, L.t);
+    blas_axpy(1.0, L.t, L.x);
+    L.cheb.smooth(L.b, L.x, postSmooth);
+}
+
+void AMG::MVP(const Vec &x, Vec &y) const
+{
+    const AMGLevel &L = *levels[0];
+    std::copy(x.begin(), x.end(), L.b.begin());
+    L.x.setAll(0.0);
+    cycle(0);
+    std::copy(L.x.begin(), L.x.end(), y.begin());
+}
+
+void AMG::solve(const Vec &b, Vec &x)
+{
+    const AMGLevel &L = *levels[0];
+    double b_norm = b.norm();
+    std::copy(b.begin(), b.end(), L.b.begin());
+    std::copy(x.begin(), x.end(), L.x.begin());
+
+    iter = 0;
+    L.A->MVP(L.x, L.t);
+    blas_axpby(1.0, L.b, -1.0, L.t, L.r);
+    relError = (b_norm > 0) ? L.r.norm() / b_norm : 0.0;
+    while (relError > tol && iter < iterMax)
+    {
+        cycle(0);
+        ++iter;
+
+        L.A->MVP(L.x, L.t);
+        blas_axpby(1.0, L.b, -1.0, L.t, L.r);
+        relError = L.r.norm() / b_norm;
+        if (verbose)
+            std::cout << "iter :" << iter << " rel_error: " << relError << std::endl;
+    }
+    std::copy(L.x.begin(), L.x.end(), x.begin());
+}
+
+double AMG::operatorComplexity() const
+{
+    double nnz0 = levels[0]->A->row_offset[rows];
+    double nnz = 0;
+    for (const auto &L : levels)
+    {
+        nnz += L->A->row_offset[L->A->rows];
+    }
+    return nnz / nnz0;
+}
+
+void AMG::printHierarchy() const
+{
+    std::ios old_state(nullptr);
+    old_state.copyfmt(std::cout);
+
+    std::cout << "level  rows      nnz" << std::endl;
+    for (int k = 0; k < numLevels(); ++k)
+    {
+        const CSRMatrix &A = *levels[k]->A;
+        std::cout << std::left << std::setw(7) << k << std::setw(10) << A.rows << A.row_offset[A.rows] << std::endl;
+    }
+    std::cout << "operator complexity: " << std::fixed << std::setprecision(3) << operatorComplexity() << std::endl;
+    std::cout.copyfmt(old_state);
+}
+
+NAMESPACE_END
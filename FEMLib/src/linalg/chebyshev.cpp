@@ -0,0 +1,265 @@
+#include <chebyshev.h>
+#include <CSRMatrix.h>
+#include <diagMatrix.h>
+#include <fem.h>
+#include <TArray.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static int sturmCount(const std::vector<double> &diag, const std::vector<double> &off, double x)
+// 对称三对角矩阵中小于x的特征值个数
+{
+    int count = 0;
+    double q = 1.0;
+    for (size_t i = 0; i < diag.size(); ++i)
+    {
+        double e2 = (i == 0) ? 0.0 : off[i - 1] * off[i - 1];
+        q = diag[i] - x - (i == 0 ? 0.0 : e2 / q);
+        if (q == 0.0)
+        {
+            q = 1e-300;
+        }
+        if (q < 0)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+static void tridiagExtremeEigenvalues(const std::vector<double> &diag, const std::vector<double> &off, double *emin, double *emax)
+/* 使用Sturm序列二分求三对角矩阵的最小和最大特征值
+ * 初始区间由Gershgorin圆盘给出
+ */
+{
+    int m = diag.size();
+    double lo = diag[0], hi = diag[0];
+    for (int i = 0; i < m; ++i)
+    {
+        double radius = 0.0;
+        if (i > 0)
+            radius += std::abs(off[i - 1]);
+        if (i < m - 1)
+            radius += std::abs(off[i]);
+        lo = std::min(lo, diag[i] - radius);
+        hi = std::max(hi, diag[i] + radius);
+    }
+
+    // 第k小的特征值为使 count(x) >= k+1 的最小x
+    auto kth = [&](int k)
+    {
+        double a = lo, b = hi;
+        for (int it = 0; it < 100 && b - a > 1e-12 * std::max(1.0, std::abs(b)); ++it)
+        {
+            double mid = 0.5 * (a + b);
+            if (sturmCount(diag, off, mid) > k)
+                b = mid;
+            else
+                a = mid;
+        }
+        return 0.5 * (a + b);
+    };
+
+    *emin = kth(0);
+    *emax = kth(m - 1);
+}
+
+Chebyshev::Chebyshev()
+    : Matrix(0, 0), A(nullptr), lambdaMin(0), lambdaMax(0), smoothRatio(30.0), safety(1.1), degree(8)
+{
+}
+
+void Chebyshev::attach(const CSRMatrix &A_CSR, int lanczosSteps)
+{
+    A = &A_CSR;
+    rows = A_CSR.rows;
+    cols = A_CSR.cols;
+
+    diagMatrix D(rows);
+    buildDiagMatrix(A_CSR, D);
+    invDiag.resize(rows);
+    for (int i = 0; i < rows; ++i)
+    {
+        if (D.diag[i] == 0)
+        {
+            throw std::invalid_argument("Chebyshev: zero diagonal entry, Jacobi scaling is not defined.");
+        }
+        invDiag[i] = 1.0 / D.diag[i];
+    }
+
+    r.resize(rows);
+    d.resize(rows);
+    Ad.resize(rows);
+
+    estimateEigenvalues(lanczosSteps);
+}
+
+void Chebyshev::estimateEigenvalues(int steps)
+/* 以Jacobi为预条件的CG与Lanczos过程等价
+ * 记录CG中的alpha_j, beta_j, 可以得到三对角矩阵T的元素
+ *      T[0][0] = 1 / alpha_0
+ *      T[j][j] = 1 / alpha_j + beta_{j-1} / alpha_{j-1}
+ *      T[j][j+1] = sqrt(beta_j) / alpha_j
+ * T的特征值(Ritz值)从内部逼近 D^{-1}A 谱的两端
+ */
+{
+    int n = rows;
+    Vec b(n), x(n, 0.0), res(n), z(n), p(n), Ap(n);
+
+    // 确定性的伪随机右端项，去除均值避免落入常数零空间
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < n; ++i)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        b[i] = (double)(state >> 11) / (double)(1ULL << 53) - 0.5;
+    }
+    double mean = b.sum() / n;
+    for (int i = 0; i < n; ++i)
+    {
+        b[i] -= mean;
+    }
+
+    res = b;
+    for (int i = 0; i < n; ++i)
+    {
+        z[i] = invDiag[i] * res[i];
+    }
+    p = z;
+    double rz = dot(res, z);
+    double r0 = std::sqrt(dot(res, res));
+
+    std::vector<double> alphas, betas;
+    for (int j = 0; j < steps; ++j)
+    {
+        A->MVP(p, Ap);
+        double pAp = dot(p, Ap);
+        if (pAp <= 0)
+        {
+            break;
+        }
+        double alpha = rz / pAp;
+        alphas.push_back(alpha);
+
+        blas_axpy(-alpha, Ap, res);
+        for (int i = 0; i < n; ++i)
+        {
+            z[i] = invDiag[i] * res[i];
+        }
+        double rz_new = dot(res, z);
+        double beta = rz_new / rz;
+        betas.push_back(beta);
+        rz = rz_new;
+
+        if (std::sqrt(dot(res, res)) < 1e-12 * r0)
+        {
+            break;
+        }
+        blas_axpby(1.0, z, beta, p, p);
+    }
+
+    if (alphas.empty())
+    {
+        throw std::runtime_error("Chebyshev: eigenvalue estimation failed, the matrix is not positive definite.");
+    }
+
+    int m = alphas.size();
+    std::vector<double> diag(m), off(std::max(m - 1, 0));
+    for (int j = 0; j < m; ++j)
+    {
+        diag[j] = 1.0 / alphas[j];
+        if (j > 0)
+        {
+            diag[j] += betas[j - 1] / alphas[j - 1];
+            off[j - 1] = std::sqrt(betas[j - 1]) / alphas[j - 1];
+        }
+    }
+
+    tridiagExtremeEigenvalues(diag, off, &lambdaMin, &lambdaMax);
+}
+
+void Chebyshev::setBounds(double lmin, double lmax)
+{
+    lambdaMin = lmin;
+    lambdaMax = lmax;
+}
+
+void Chebyshev::iterate(const Vec &b, Vec &x, bool zeroGuess, double a, double c, int iter) const
+/* 在区间[a, c]上的Chebyshev迭代 (Saad, Iterative Methods, Alg. 12.1)
+ *      theta = (c + a) / 2, delta = (c - a) / 2, sigma = theta / delta, rho_0 = 1 / sigma
+ *      r_0 = b - A x_0, d_0 = D^{-1} r_0 / theta
+ *      x_{k+1} = x_k + d_k
+ *      r_{k+1} = r_k - A d_k
+ *      rho_{k+1} = 1 / (2 sigma - rho_k)
+ *      d_{k+1} = rho_{k+1} rho_k d_k + 2 rho_{k+1} / delta * D^{-1} r_{k+1}
+ * 每一步只有一次SpMV和一次融合的逐元素更新，没有内积
+ */
+{
+    int n = rows;
+    double theta = 0.5 * (c + a);
+    double delta = 0.5 * (c - a);
+    double sigma = theta / delta;
+    double rho = 1.0 / sigma;
+
+    if (zeroGuess)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            r[i] = b[i];
+            d[i] = invDiag[i] * b[i] / theta;
+            x[i] = d[i];
+        }
+    }
+    else
+    {
+        A->MVP(x, r);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            r[i] = b[i] - r[i];
+            d[i] = invDiag[i] * r[i] / theta;
+            x[i] += d[i];
+        }
+    }
+
+    for (int k = 1; k < iter; ++k)
+    {
+        A->MVP(d, Ad);
+        double rho_new = 1.0 / (2.0 * sigma - rho);
+        double c1 = rho_new * rho;
+        double c2 = 2.0 * rho_new / delta;
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            r[i] -= Ad[i];
+            d[i] = c1 * d[i] + c2 * invDiag[i] * r[i];
+            x[i] += d[i];
+        }
+        rho = rho_new;
+    }
+}
+
+void Chebyshev::smooth(const Vec &b, Vec &x, int iter) const
+{
+    double c = safety * lambdaMax;
+    iterate(b, x, false, c / smoothRatio, c, iter);
+}
+
+void Chebyshev::MVP(const Vec &x, Vec &y) const
+// 作为预条件子：以零为初值的固定次数迭代，y = p(A) x 关于x是线性的
+{
+    if ((size_t)cols != x.size || (size_t)rows != y.size)
+    {
+        throw std::invalid_argument("Size mismatch: The number of columns in the matrix does not match the size of the vector.");
+    }
+    double c = safety * lambdaMax;
+    double a = std::max(lambdaMin, c / 1e4);
+    iterate(x, y, true, a, c, degree);
+}
+
+NAMESPACE_END
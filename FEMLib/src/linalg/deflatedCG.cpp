@@ -0,0 +1,454 @@
+#include <deflatedCG.h>
+#include <Matrix.h>
+#include <TArray.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static void jacobiEigen(int m, std::vector<double> &a, std::vector<double> &v, std::vector<double> &eig)
+/* 循环Jacobi方法求m x m对称矩阵a的特征分解 a = V diag(eig) V^T
+ * a按行存储，计算后被破坏，v的第j列为第j个特征向量
+ */
+{
+    v.assign(m * m, 0.0);
+    for (int i = 0; i < m; ++i)
+    {
+        v[i * m + i] = 1.0;
+    }
+
+    for (int sweep = 0; sweep < 50; ++sweep)
+    {
+        double off = 0.0, total = 0.0;
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < m; ++j)
+            {
+                total += a[i * m + j] * a[i * m + j];
+                if (i != j)
+                    off += a[i * m + j] * a[i * m + j];
+            }
+        }
+        if (off <= 1e-30 * total)
+        {
+            break;
+        }
+
+        for (int p = 0; p < m - 1; ++p)
+        {
+            for (int q = p + 1; q < m; ++q)
+            {
+                double apq = a[p * m + q];
+                if (std::abs(apq) < 1e-300)
+                {
+                    continue;
+                }
+                double theta = (a[q * m + q] - a[p * m + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < m; ++k)
+                {
+                    double akp = a[k * m + p], akq = a[k * m + q];
+                    a[k * m + p] = c * akp - s * akq;
+                    a[k * m + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < m; ++k)
+                {
+                    double apk = a[p * m + k], aqk = a[q * m + k];
+                    a[p * m + k] = c * apk - s * aqk;
+                    a[q * m + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < m; ++k)
+                {
+                    double vkp = v[k * m + p], vkq = v[k * m + q];
+                    v[k * m + p] = c * vkp - s * vkq;
+                    v[k * m + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    eig.resize(m);
+    for (int i = 0; i < m; ++i)
+    {
+        eig[i] = a[i * m + i];
+    }
+}
+
+static void gramMatrices(int m, const double *const *Z, const double *const *AZ, size_t n, std::vector<double> &F, std::vector<double> &G)
+// 一次遍历计算 F = Z^T A Z 和 G = Z^T Z
+{
+    F.assign(m * m, 0.0);
+    G.assign(m * m, 0.0);
+#pragma omp parallel
+    {
+        std::vector<double> Fl(m * m, 0.0), Gl(m * m, 0.0);
+#pragma omp for
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (int a = 0; a < m; ++a)
+            {
+                double za = Z[a][i];
+                for (int b = 0; b <= a; ++b)
+                {
+                    Fl[a * m + b] += za * AZ[b][i];
+                    Gl[a * m + b] += za * Z[b][i];
+                }
+            }
+        }
+#pragma omp critical
+        for (int t = 0; t < m * m; ++t)
+        {
+            F[t] += Fl[t];
+            G[t] += Gl[t];
+        }
+    }
+    for (int a = 0; a < m; ++a)
+    {
+        for (int b = 0; b < a; ++b)
+        {
+            F[b * m + a] = F[a * m + b];
+            G[b * m + a] = G[a * m + b];
+        }
+    }
+}
+
+DeflatedCG::DeflatedCG(int n, int k_, int l_)
+    : k(k_), l(l_), nW(0), nP(0), W(k_), AW(k_), P(l_), AP(l_)
+{
+    for (int j = 0; j < k; ++j)
+    {
+        W[j] = Vec(n, 0.0);
+        AW[j] = Vec(n, 0.0);
+    }
+    for (int j = 0; j < l; ++j)
+    {
+        P[j] = Vec(n, 0.0);
+        AP[j] = Vec(n, 0.0);
+    }
+}
+
+void DeflatedCG::reset()
+{
+    nW = 0;
+}
+
+void DeflatedCG::factorWAW()
+/* W^T A W = L L^T, 由于W由Ritz向量组成, 这个矩阵接近对角矩阵
+ * 主元相对于对角元接近0(或非正)时W数值上线性相关, 从W, AW中删去该向量, 以新的nW重新分解
+ */
+{
+    int j = 0;
+    while (j < nW)
+    {
+        WAW.assign(nW * nW, 0.0);
+        for (int a = 0; a < nW; ++a)
+        {
+            for (int b = 0; b <= a; ++b)
+            {
+                WAW[a * nW + b] = dot(W[a], AW[b]);
+            }
+        }
+        for (j = 0; j < nW; ++j)
+        {
+            double s = WAW[j * nW + j];
+            for (int t = 0; t < j; ++t)
+            {
+                s -= WAW[j * nW + t] * WAW[j * nW + t];
+            }
+            if (s <= 1e-12 * WAW[j * nW + j])
+            {
+                break;
+            }
+            double d = std::sqrt(s);
+            WAW[j * nW + j] = d;
+            for (int i = j + 1; i < nW; ++i)
+            {
+                double v = WAW[i * nW + j];
+                for (int t = 0; t < j; ++t)
+                {
+                    v -= WAW[i * nW + t] * WAW[j * nW + t];
+                }
+                WAW[i * nW + j] = v / d;
+            }
+        }
+        if (j < nW)
+        {
+            // 删去第j个向量, 之后的向量前移以保持Ritz值的顺序
+            for (int t = j; t + 1 < nW; ++t)
+            {
+                std::swap(W[t].data, W[t + 1].data);
+                std::swap(AW[t].data, AW[t + 1].data);
+            }
+            --nW;
+            j = 0;
+        }
+    }
+}
+
+void DeflatedCG::refresh(const Matrix &A)
+{
+    for (int j = 0; j < nW; ++j)
+    {
+        A.MVP(W[j], AW[j]);
+    }
+    factorWAW();
+}
+
+void DeflatedCG::project(const Vec &r)
+{
+    int m = nW;
+    mu.assign(m, 0.0);
+    if (m == 0)
+    {
+        return;
+    }
+
+    size_t n = r.size;
+    std::vector<double> acc(m, 0.0);
+#pragma omp parallel
+    {
+        std::vector<double> local(m, 0.0);
+#pragma omp for
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (int j = 0; j < m; ++j)
+            {
+                local[j] += AW[j][i] * r[i];
+            }
+        }
+#pragma omp critical
+        for (int j = 0; j < m; ++j)
+        {
+            acc[j] += local[j];
+        }
+    }
+
+    solveWAW(acc);
+}
+
+void DeflatedCG::solveWAW(const std::vector<double> &rhs)
+// 求解 L L^T mu = rhs
+{
+    int m = nW;
+    mu.assign(m, 0.0);
+    for (int i = 0; i < m; ++i)
+    {
+        double s = rhs[i];
+        for (int t = 0; t < i; ++t)
+        {
+            s -= WAW[i * m + t] * mu[t];
+        }
+        mu[i] = s / WAW[i * m + i];
+    }
+    for (int i = m - 1; i >= 0; --i)
+    {
+        double s = mu[i];
+        for (int t = i + 1; t < m; ++t)
+        {
+            s -= WAW[t * m + i] * mu[t];
+        }
+        mu[i] = s / WAW[i * m + i];
+    }
+}
+
+bool DeflatedCG::solve(const Matrix &A, const Vec &B, Vec &u, Vec &r, Vec &p, Vec &Ap, double *rel_error, int *iter, double tol, int iterMax)
+{
+    int n = B.size;
+    int m = nW;
+    double b2 = dot(B, B);
+
+    // r = B - A u, 并将u在W上的误差分量直接消去
+    A.MVP(u, r);
+    blas_axpby(1.0, B, -1.0, r, r);
+    if (m > 0)
+    {
+        // u = u + W (W^T A W)^{-1} W^T r, 使得新的残差与W正交
+        std::vector<double> acc(m);
+        for (int j = 0; j < m; ++j)
+        {
+            acc[j] = dot(W[j], r);
+        }
+        solveWAW(acc);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            double du = 0.0, dr = 0.0;
+            for (int j = 0; j < m; ++j)
+            {
+                du += W[j][i] * mu[j];
+                dr += AW[j][i] * mu[j];
+            }
+            u[i] += du;
+            r[i] -= dr;
+        }
+    }
+
+    double r2 = dot(r, r);
+    *rel_error = std::sqrt(r2 / b2);
+    *iter = 0;
+    nP = 0;
+
+    // p_0 = r_0 - W mu_0
+    project(r);
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        double s = 0.0;
+        for (int j = 0; j < m; ++j)
+        {
+            s += W[j][i] * mu[j];
+        }
+        p[i] = r[i] - s;
+    }
+
+    while (*rel_error > tol && *iter < iterMax)
+    {
+        ++(*iter);
+        A.MVP(p, Ap);
+        if (nP < l)
+        {
+            // 保存搜索方向用于之后的Rayleigh-Ritz
+            std::copy(p.begin(), p.end(), P[nP].begin());
+            std::copy(Ap.begin(), Ap.end(), AP[nP].begin());
+            ++nP;
+        }
+
+        double alpha = r2 / dot(p, Ap);
+        blas_axpy(alpha, p, u);
+        blas_axpy(-alpha, Ap, r);
+
+        double r2_new = dot(r, r);
+        double beta = r2_new / r2;
+        r2 = r2_new;
+        *rel_error = std::sqrt(r2 / b2);
+
+        project(r);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            double s = 0.0;
+            for (int j = 0; j < m; ++j)
+            {
+                s += W[j][i] * mu[j];
+            }
+            p[i] = beta * p[i] + r[i] - s;
+        }
+    }
+
+    harvest();
+
+    return *rel_error <= tol;
+}
+
+void DeflatedCG::harvest()
+/* 在Z = [W, P]上做Rayleigh-Ritz: F y = theta G y, F = Z^T A Z, G = Z^T Z
+ * 先对G做特征分解, 去掉数值上线性相关的方向, 得到 T = V_r Lambda_r^{-1/2}
+ * 再求解标准特征值问题 (T^T F T) y' = theta y', 取最小的k个, y = T y'
+ */
+{
+    int m = nW + nP;
+    if (m == 0 || k == 0)
+    {
+        return;
+    }
+    size_t n = W[0].size;
+
+    std::vector<const double *> Z(m), AZ(m);
+    for (int j = 0; j < nW; ++j)
+    {
+        Z[j] = W[j].data;
+        AZ[j] = AW[j].data;
+    }
+    for (int j = 0; j < nP; ++j)
+    {
+        Z[nW + j] = P[j].data;
+        AZ[nW + j] = AP[j].data;
+    }
+
+    std::vector<double> F, G, V, lambda;
+    gramMatrices(m, Z.data(), AZ.data(), n, F, G);
+    jacobiEigen(m, G, V, lambda);
+
+    double lmax = *std::max_element(lambda.begin(), lambda.end());
+    std::vector<int> keep;
+    for (int j = 0; j < m; ++j)
+    {
+        if (lambda[j] > 1e-12 * lmax)
+        {
+            keep.push_back(j);
+        }
+    }
+    int rnk = keep.size();
+
+    // T = V_r Lambda_r^{-1/2}, m x rnk
+    std::vector<double> T(m * rnk);
+    for (int a = 0; a < m; ++a)
+    {
+        for (int c = 0; c < rnk; ++c)
+        {
+            T[a * rnk + c] = V[a * m + keep[c]] / std::sqrt(lambda[keep[c]]);
+        }
+    }
+
+    // Fr = T^T F T
+    std::vector<double> FT(m * rnk, 0.0), Fr(rnk * rnk, 0.0);
+    for (int a = 0; a < m; ++a)
+        for (int c = 0; c < rnk; ++c)
+            for (int b = 0; b < m; ++b)
+                FT[a * rnk + c] += F[a * m + b] * T[b * rnk + c];
+    for (int c = 0; c < rnk; ++c)
+        for (int d = 0; d < rnk; ++d)
+            for (int a = 0; a < m; ++a)
+                Fr[c * rnk + d] += T[a * rnk + c] * FT[a * rnk + d];
+
+    std::vector<double> U, theta;
+    jacobiEigen(rnk, Fr, U, theta);
+
+    std::vector<int> order(rnk);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b)
+              { return theta[a] < theta[b]; });
+
+    int kNew = std::min(k, rnk);
+    // Y = T U_k, m x kNew
+    std::vector<double> Y(m * kNew, 0.0);
+    for (int a = 0; a < m; ++a)
+        for (int j = 0; j < kNew; ++j)
+            for (int c = 0; c < rnk; ++c)
+                Y[a * kNew + j] += T[a * rnk + c] * U[c * rnk + order[j]];
+
+    // 新的W = Z Y, 由于Z包含W本身, 逐行计算后写回
+#pragma omp parallel
+    {
+        std::vector<double> zi(m), azi(m);
+#pragma omp for
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (int a = 0; a < m; ++a)
+            {
+                zi[a] = Z[a][i];
+                azi[a] = AZ[a][i];
+            }
+            for (int j = 0; j < kNew; ++j)
+            {
+                double w = 0.0, aw = 0.0;
+                for (int a = 0; a < m; ++a)
+                {
+                    w += zi[a] * Y[a * kNew + j];
+                    aw += azi[a] * Y[a * kNew + j];
+                }
+                W[j][i] = w;
+                AW[j][i] = aw;
+            }
+        }
+    }
+    nW = kNew;
+    factorWAW();
+}
+
+NAMESPACE_END
@@ -8,11 +8,10 @@
 #include <Mesh.h>
 #include <vector>
 #include <diagMatrix.h>
+#include <TripletAssembler.h>
 
 NAMESPACE_BEGIN(FEMLib)
 
-static void massLoc(const Vec3 &AB, const Vec3 &AC, double *Mloc);  // 根据输入两个向量代表的三角形计算局部质量矩阵
-static void stiffLoc(const Vec3 &AB, const Vec3 &AC, double *Sloc); // 同上，计算刚度矩阵
 
 void buildMassMatrix(FEMatrix &M)
 /* 根据网格建立质量矩阵
@@ -50,7 +49,7 @@ void buildMassMatrix(FEMatrix &M)
     }
 }
 
-static void massLoc(const Vec3 &AB, const Vec3 &AC, double *Mloc)
+void massLoc(const Vec3 &AB, const Vec3 &AC, double *Mloc)
 /* 根据输入的向量AB和AC计算局部质量矩阵
  * 首先计算三角形面积，公式为 |ABC| = 0.5 * |AB x AC|
  */
@@ -94,7 +93,7 @@ void buildStiffnessMatrix(FEMatrix &S)
     }
 }
 
-static void stiffLoc(const Vec3 &AB, const Vec3 &AC, double *Sloc)
+void stiffLoc(const Vec3 &AB, const Vec3 &AC, double *Sloc)
 /* 计算局部刚度矩阵
  * BC = AC - AB
  * 存储顺序是S_AB, S_AC, S_BC
@@ -287,6 +286,55 @@ void buildStiffnessMatrix(CSRMatrix &S, Mesh &mesh)
     }
 }
 
+/*-------------------通用网格的组装-------------------*/
+void assembleMassMatrix(CSRMatrix &M, const Mesh &mesh)
+{
+    int n = mesh.vertex_count();
+    TripletAssembler assembler(n, n);
+    assembler.reserve(9 * mesh.triangle_count() / assembler.buffers.size() + 16);
+#pragma omp parallel for
+    for (long t = 0; t < (long)mesh.triangle_count(); ++t)
+    {
+        uint32_t v[3] = {mesh.indices[3 * t + 0], mesh.indices[3 * t + 1], mesh.indices[3 * t + 2]};
+        Vec3 AB = mesh.vertices[v[1]] - mesh.vertices[v[0]];
+        Vec3 AC = mesh.vertices[v[2]] - mesh.vertices[v[0]];
+        double Mloc[2];
+        massLoc(AB, AC, Mloc);
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                assembler.add(v[i], v[j], i == j ? Mloc[0] : Mloc[1]);
+            }
+        }
+    }
+    assembler.assemble(M);
+}
+
+void assembleStiffnessMatrix(CSRMatrix &S, const Mesh &mesh)
+{
+    int n = mesh.vertex_count();
+    TripletAssembler assembler(n, n);
+    assembler.reserve(9 * mesh.triangle_count() / assembler.buffers.size() + 16);
+#pragma omp parallel for
+    for (long t = 0; t < (long)mesh.triangle_count(); ++t)
+    {
+        uint32_t v[3] = {mesh.indices[3 * t + 0], mesh.indices[3 * t + 1], mesh.indices[3 * t + 2]};
+        Vec3 AB = mesh.vertices[v[1]] - mesh.vertices[v[0]];
+        Vec3 AC = mesh.vertices[v[2]] - mesh.vertices[v[0]];
+        double Sloc[6];
+        stiffLoc(AB, AC, Sloc);
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                assembler.add(v[i], v[j], Sloc[get_Sloc_index(i, j)]);
+            }
+        }
+    }
+    assembler.assemble(S);
+}
+
 void addMassToStiffness(CSRMatrix &S, CSRMatrix &M)
 // 将质量矩阵加到刚度矩阵，方便定义和使用统一的MVP
 {
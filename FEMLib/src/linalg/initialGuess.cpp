@@ -0,0 +1,132 @@
+#include <initialGuess.h>
+#include <Matrix.h>
+#include <TArray.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+InitialGuess::InitialGuess(int n, Mode m, int history)
+    : mode(m), maxHistory(history), count(0), head(0)
+{
+    if (mode == EXTRAPOLATION)
+    {
+        maxHistory = std::min(maxHistory, 3); // 高阶外推会放大误差，最多使用二阶
+    }
+    if (mode == PREVIOUS)
+    {
+        maxHistory = 0;
+    }
+    X.resize(maxHistory);
+    AX.resize(maxHistory);
+    for (int k = 0; k < maxHistory; ++k)
+    {
+        X[k] = Vec(n, 0.0);
+        AX[k] = Vec(n, 0.0);
+    }
+}
+
+void InitialGuess::reset()
+{
+    count = 0;
+    head = 0;
+}
+
+bool InitialGuess::guess(const Vec &b, Vec &x, Vec &Ax) const
+{
+    if (count == 0)
+    {
+        return false;
+    }
+
+    int n = x.size;
+    int m = count;
+    std::vector<double> c(m);
+
+    if (mode == PROJECTION)
+    {
+        // x0 = sum_k <X_k, b> X_k
+        for (int k = 0; k < m; ++k)
+        {
+            c[k] = dot(X[k], b);
+        }
+    }
+    else
+    {
+        // 按时间由新到旧排列的外推系数
+        static const double coef[3][3] = {{1.0, 0.0, 0.0}, {2.0, -1.0, 0.0}, {3.0, -3.0, 1.0}};
+        for (int k = 0; k < m; ++k)
+        {
+            c[k] = coef[m - 1][k];
+        }
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        double xi = 0.0, Axi = 0.0;
+        for (int k = 0; k < m; ++k)
+        {
+            int slot = (mode == PROJECTION) ? k : (head - k + maxHistory) % maxHistory;
+            xi += c[k] * X[slot][i];
+            Axi += c[k] * AX[slot][i];
+        }
+        x[i] = xi;
+        Ax[i] = Axi;
+    }
+    return true;
+}
+
+void InitialGuess::update(const Matrix &A, const Vec &x, Vec &Ax)
+{
+    if (maxHistory == 0)
+    {
+        return;
+    }
+
+    A.MVP(x, Ax);
+
+    if (mode == EXTRAPOLATION)
+    {
+        head = (count == 0) ? 0 : (head + 1) % maxHistory;
+        X[head] = x;
+        AX[head] = Ax;
+        count = std::min(count + 1, maxHistory);
+        return;
+    }
+
+    // PROJECTION: 基满了之后重新开始，只保留最新的解
+    if (count == maxHistory)
+    {
+        count = 0;
+    }
+
+    Vec &v = X[count];
+    Vec &Av = AX[count];
+    v = x;
+    Av = Ax;
+    double norm0 = std::sqrt(std::abs(dot(v, Av)));
+
+    // 在A-内积下做两次Gram-Schmidt正交化
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int k = 0; k < count; ++k)
+        {
+            double c = dot(X[k], Av);
+            blas_axpy(-c, X[k], v);
+            blas_axpy(-c, AX[k], Av);
+        }
+    }
+
+    double norm = std::sqrt(std::abs(dot(v, Av)));
+    if (norm <= 1e-10 * norm0 || norm == 0.0)
+    {
+        return; // 新的解已经在span(X)中
+    }
+    v.scaleInPlace(1.0 / norm);
+    Av.scaleInPlace(1.0 / norm);
+    ++count;
+}
+
+NAMESPACE_END
@@ -0,0 +1,294 @@
+#include <ordering.h>
+#include <CSRMatrix.h>
+#include <TArray.h>
+#include <vector>
+#include <algorithm>
+
+NAMESPACE_BEGIN(FEMLib)
+
+struct NDTask
+{
+    std::vector<int> nodes; // 子图中的顶点
+    int lo;                 // 子图在新编号中的起始位置
+    int id;                 // 子图编号, 与label对应
+};
+
+static int bfsLevels(const CSRMatrix &A, int root, int id, const std::vector<int> &label,
+                     std::vector<int> &level, std::vector<int> &queue)
+/* 从root出发，在label为id的子图中做BFS, 返回最大层数
+ * queue按访问顺序存储所有访问到的点
+ */
+{
+    queue.clear();
+    queue.push_back(root);
+    level[root] = 0;
+    int depth = 0;
+    for (size_t h = 0; h < queue.size(); ++h)
+    {
+        int v = queue[h];
+        for (size_t t = A.row_offset[v]; t < A.row_offset[v + 1]; ++t)
+        {
+            int u = A.elm_idx[t];
+            if (label[u] == id && level[u] < 0)
+            {
+                level[u] = level[v] + 1;
+                depth = std::max(depth, level[u]);
+                queue.push_back(u);
+            }
+        }
+    }
+    return depth;
+}
+
+void nestedDissection(const CSRMatrix &A, TArray<int> &perm, int leafSize)
+{
+    int n = A.rows;
+    perm.resize(n);
+    std::vector<int> label(n, 0);
+    std::vector<int> level(n, -1);
+    std::vector<int> queue;
+    queue.reserve(n);
+
+    std::vector<NDTask> stack;
+    NDTask root;
+    root.nodes.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        root.nodes[i] = i;
+    }
+    root.lo = 0;
+    root.id = 0;
+    stack.push_back(std::move(root));
+    int nextId = 1;
+
+    while (!stack.empty())
+    {
+        NDTask task = std::move(stack.back());
+        stack.pop_back();
+        int m = task.nodes.size();
+        if (m == 0)
+        {
+            continue;
+        }
+
+        auto resetLevels = [&]()
+        {
+            for (int v : task.nodes)
+            {
+                level[v] = -1;
+            }
+        };
+
+        if (m <= leafSize)
+        {
+            // 小的子图按BFS顺序编号, 保持局部性
+            int pos = task.lo;
+            for (int v : task.nodes)
+            {
+                if (level[v] >= 0)
+                    continue;
+                bfsLevels(A, v, task.id, label, level, queue);
+                for (int u : queue)
+                {
+                    perm[pos++] = u;
+                }
+            }
+            resetLevels();
+            continue;
+        }
+
+        // 寻找伪外围点: 反复从最深一层中度数最小的点出发BFS, 直到深度不再增加
+        int start = task.nodes[0];
+        int depth = bfsLevels(A, start, task.id, label, level, queue);
+        for (int it = 0; it < 4; ++it)
+        {
+            int best = -1;
+            size_t bestDeg = (size_t)-1;
+            for (int v : queue)
+            {
+                size_t deg = A.row_offset[v + 1] - A.row_offset[v];
+                if (level[v] == depth && deg < bestDeg)
+                {
+                    best = v;
+                    bestDeg = deg;
+                }
+            }
+            resetLevels();
+            int newDepth = bfsLevels(A, best, task.id, label, level, queue);
+            bool improved = newDepth > depth;
+            start = best;
+            depth = newDepth;
+            if (!improved)
+            {
+                break;
+            }
+        }
+
+        if ((int)queue.size() < m)
+        {
+            // 子图不连通: 当前连通分支与其余部分分开处理, 不需要分隔集
+            NDTask a, b;
+            a.nodes = queue;
+            for (int v : task.nodes)
+            {
+                if (level[v] < 0)
+                    b.nodes.push_back(v);
+            }
+            resetLevels();
+            a.id = nextId++;
+            b.id = nextId++;
+            for (int v : a.nodes)
+                label[v] = a.id;
+            for (int v : b.nodes)
+                label[v] = b.id;
+            a.lo = task.lo;
+            b.lo = task.lo + a.nodes.size();
+            stack.push_back(std::move(a));
+            stack.push_back(std::move(b));
+            continue;
+        }
+
+        if (depth < 2)
+        {
+            // 图的直径太小，无法有效剖分
+            int pos = task.lo;
+            for (int v : queue)
+            {
+                perm[pos++] = v;
+            }
+            resetLevels();
+            continue;
+        }
+
+        // 选择使两侧规模接近的中间层作为分隔集
+        std::vector<int> levelCount(depth + 1, 0);
+        for (int v : queue)
+        {
+            levelCount[level[v]]++;
+        }
+        int sepLevel = 1, acc = levelCount[0];
+        while (sepLevel < depth - 1 && acc + levelCount[sepLevel] < m / 2)
+        {
+            acc += levelCount[sepLevel];
+            ++sepLevel;
+        }
+
+        NDTask a, b;
+        std::vector<int> sep;
+        for (int v : queue)
+        {
+            int lv = level[v];
+            if (lv < sepLevel)
+            {
+                a.nodes.push_back(v);
+            }
+            else if (lv > sepLevel)
+            {
+                b.nodes.push_back(v);
+            }
+            else
+            {
+                // 只有与下一层相邻的点才需要留在分隔集中
+                bool touches = false;
+                for (size_t t = A.row_offset[v]; t < A.row_offset[v + 1] && !touches; ++t)
+                {
+                    int u = A.elm_idx[t];
+                    touches = (label[u] == task.id && level[u] == sepLevel + 1);
+                }
+                if (touches)
+                    sep.push_back(v);
+                else
+                    a.nodes.push_back(v);
+            }
+        }
+        resetLevels();
+
+        a.id = nextId++;
+        b.id = nextId++;
+        for (int v : a.nodes)
+            label[v] = a.id;
+        for (int v : b.nodes)
+            label[v] = b.id;
+        for (int v : sep)
+            label[v] = -1;
+
+        int sepStart = task.lo + m - (int)sep.size();
+        for (size_t k = 0; k < sep.size(); ++k)
+        {
+            perm[sepStart + k] = sep[k];
+        }
+        a.lo = task.lo;
+        b.lo = task.lo + a.nodes.size();
+        stack.push_back(std::move(a));
+        stack.push_back(std::move(b));
+    }
+}
+
+void etreePostorder(const CSRMatrix &A, const TArray<int> &perm, TArray<int> &parent, TArray<int> &post)
+{
+    int n = A.rows;
+    std::vector<int> iperm(n);
+    for (int k = 0; k < n; ++k)
+    {
+        iperm[perm[k]] = k;
+    }
+
+    // Liu的算法, 使用路径压缩的祖先数组
+    parent.resize(n);
+    std::vector<int> ancestor(n, -1);
+    for (int k = 0; k < n; ++k)
+    {
+        parent[k] = -1;
+        int old = perm[k];
+        for (size_t t = A.row_offset[old]; t < A.row_offset[old + 1]; ++t)
+        {
+            int i = iperm[A.elm_idx[t]];
+            while (i != -1 && i < k)
+            {
+                int next = ancestor[i];
+                ancestor[i] = k;
+                if (next == -1)
+                {
+                    parent[i] = k;
+                }
+                i = next;
+            }
+        }
+    }
+
+    // 非递归的后序遍历
+    std::vector<int> head(n, -1), next(n, -1), stack;
+    for (int j = n - 1; j >= 0; --j)
+    {
+        if (parent[j] != -1)
+        {
+            next[j] = head[parent[j]];
+            head[parent[j]] = j;
+        }
+    }
+    post.resize(n);
+    int k = 0;
+    for (int j = 0; j < n; ++j)
+    {
+        if (parent[j] != -1)
+            continue;
+        stack.push_back(j);
+        while (!stack.empty())
+        {
+            int p = stack.back();
+            int c = head[p];
+            if (c == -1)
+            {
+                stack.pop_back();
+                post[k++] = p;
+            }
+            else
+            {
+                head[p] = next[c];
+                stack.push_back(c);
+            }
+        }
+    }
+}
+
+NAMESPACE_END
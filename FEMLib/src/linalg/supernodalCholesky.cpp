@@ -0,0 +1,599 @@
+#include <supernodalCholesky.h>
+#include <ordering.h>
+#include <CSRMatrix.h>
+#include <TArray.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static const int BLOCK_ROWS = 256; // gemm中行方向的分块大小
+static const int BLOCK_K = 64;     // gemm中求和方向的分块大小
+static const int PANEL = 32;       // 稠密Cholesky的列分块大小
+
+static void gemmNT(int M, int N, int K, const double *A, int lda, const double *B, int ldb, double *C, int ldc)
+/* C -= A * B^T, 均为列主序
+ * A: M x K, B: N x K, C: M x N
+ * 按行和求和方向分块，使A的一块和C的一列留在缓存中，最内层循环连续访存便于向量化
+ */
+{
+    size_t work = (size_t)M * N * K;
+#pragma omp parallel for schedule(dynamic) if (work > 2000000)
+    for (int ib = 0; ib < M; ib += BLOCK_ROWS)
+    {
+        int ie = std::min(M, ib + BLOCK_ROWS);
+        for (int kb = 0; kb < K; kb += BLOCK_K)
+        {
+            int ke = std::min(K, kb + BLOCK_K);
+            for (int j = 0; j < N; ++j)
+            {
+                double *c = C + (size_t)j * ldc;
+                for (int k = kb; k < ke; ++k)
+                {
+                    double bjk = B[j + (size_t)k * ldb];
+                    const double *a = A + (size_t)k * lda;
+                    for (int i = ib; i < ie; ++i)
+                    {
+                        c[i] -= a[i] * bjk;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void densePanelCholesky(double *L, int m, int w)
+/* 对 m x w 的列主序块(leading dimension为m)做Cholesky
+ * 上方 w x w 为对角块, 分解为下三角; 下方 (m - w) x w 得到 L21 = A21 * L11^{-T}
+ * 按PANEL列分块: 先用前面的列通过gemm更新当前块, 再在块内逐列计算
+ */
+{
+    for (int jb = 0; jb < w; jb += PANEL)
+    {
+        int je = std::min(w, jb + PANEL);
+        if (jb > 0)
+        {
+            gemmNT(m - jb, je - jb, jb, L + jb, m, L + jb, m, L + jb + (size_t)jb * m, m);
+        }
+        for (int c = jb; c < je; ++c)
+        {
+            double *lc = L + (size_t)c * m;
+            for (int k = jb; k < c; ++k)
+            {
+                const double *lk = L + (size_t)k * m;
+                double lck = lk[c];
+                for (int i = c; i < m; ++i)
+                {
+                    lc[i] -= lk[i] * lck;
+                }
+            }
+            double d = lc[c];
+            if (!(d > 0))
+            {
+                throw std::runtime_error("SupernodalCholesky: matrix is not positive definite.");
+            }
+            d = std::sqrt(d);
+            lc[c] = d;
+            double inv = 1.0 / d;
+            for (int i = c + 1; i < m; ++i)
+            {
+                lc[i] *= inv;
+            }
+        }
+    }
+}
+
+SupernodalCholesky::SupernodalCholesky()
+    : n(0), A(nullptr), epsilon(0), isInitialized(false), nsuper(0)
+{
+}
+
+void SupernodalCholesky::attach(CSRMatrix &A_CSR, double eps)
+{
+    analyze(A_CSR);
+    epsilon = eps;
+}
+
+void SupernodalCholesky::attach(CSRMatrix &A_CSR)
+{
+    analyze(A_CSR);
+}
+
+void SupernodalCholesky::factorize(const CSRMatrix &A_CSR, double eps)
+{
+    A = &A_CSR;
+    epsilon = eps;
+    compute();
+}
+
+void SupernodalCholesky::analyze(const CSRMatrix &A_CSR)
+{
+    A = &A_CSR;
+    n = A_CSR.rows;
+    epsilon = 0;
+
+    // 1. 嵌套剖分 + 消去树后序
+    TArray<int> ndPerm, parent0, post;
+    nestedDissection(A_CSR, ndPerm);
+    etreePostorder(A_CSR, ndPerm, parent0, post);
+
+    perm.resize(n);
+    iperm.resize(n);
+    std::vector<int> ipost(n), parent(n);
+    for (int k = 0; k < n; ++k)
+    {
+        perm[k] = ndPerm[post[k]];
+        ipost[post[k]] = k;
+    }
+    for (int k = 0; k < n; ++k)
+    {
+        iperm[perm[k]] = k;
+        int p = parent0[post[k]];
+        parent[k] = (p == -1) ? -1 : ipost[p];
+    }
+
+    // 2. 排序后矩阵的下三角结构
+    colPtr.resize(n + 1);
+    colPtr[0] = 0;
+    for (int j = 0; j < n; ++j)
+    {
+        int old = perm[j];
+        size_t cnt = 0;
+        for (size_t t = A_CSR.row_offset[old]; t < A_CSR.row_offset[old + 1]; ++t)
+        {
+            if (iperm[A_CSR.elm_idx[t]] >= j)
+                ++cnt;
+        }
+        colPtr[j + 1] = colPtr[j] + cnt;
+    }
+    colRow.resize(colPtr[n]);
+    colSrc.resize(colPtr[n]);
+#pragma omp parallel for
+    for (int j = 0; j < n; ++j)
+    {
+        int old = perm[j];
+        size_t pos = colPtr[j];
+        for (size_t t = A_CSR.row_offset[old]; t < A_CSR.row_offset[old + 1]; ++t)
+        {
+            int i = iperm[A_CSR.elm_idx[t]];
+            if (i >= j)
+            {
+                colRow[pos] = i;
+                colSrc[pos] = t;
+                ++pos;
+            }
+        }
+    }
+
+    // 3. 通过行子树计算每一列的非零个数: L的第i行的结构是消去树中从A第i行非零列到i的路径
+    std::vector<int> colCount(n, 1), mark(n, -1), childCount(n, 0);
+    for (int i = 0; i < n; ++i)
+    {
+        mark[i] = i;
+        int old = perm[i];
+        for (size_t t = A_CSR.row_offset[old]; t < A_CSR.row_offset[old + 1]; ++t)
+        {
+            int j = iperm[A_CSR.elm_idx[t]];
+            if (j >= i)
+                continue;
+            while (mark[j] != i)
+            {
+                mark[j] = i;
+                colCount[j]++;
+                j = parent[j];
+            }
+        }
+        if (parent[i] != -1)
+        {
+            childCount[parent[i]]++;
+        }
+    }
+
+    // 4. 基本超节点
+    std::vector<int> starts;
+    for (int j = 0; j < n; ++j)
+    {
+        bool merge = j > 0 && parent[j - 1] == j && childCount[j] == 1 && colCount[j - 1] == colCount[j] + 1;
+        if (!merge)
+        {
+            starts.push_back(j);
+        }
+    }
+    nsuper = starts.size();
+    superStart.resize(nsuper + 1);
+    for (int s = 0; s < nsuper; ++s)
+    {
+        superStart[s] = starts[s];
+    }
+    superStart[nsuper] = n;
+
+    colToSuper.resize(n);
+    for (int s = 0; s < nsuper; ++s)
+    {
+        for (int j = superStart[s]; j < superStart[s + 1]; ++j)
+        {
+            colToSuper[j] = s;
+        }
+    }
+
+    // 5. 超节点的行结构: 自身各列在A中的结构与所有子超节点结构的并
+    rowPtr.resize(nsuper + 1);
+    rowPtr[0] = 0;
+    for (int s = 0; s < nsuper; ++s)
+    {
+        rowPtr[s + 1] = rowPtr[s] + colCount[superStart[s]];
+    }
+    rowIdx.resize(rowPtr[nsuper]);
+
+    std::vector<int> childHead(nsuper, -1), childNext(nsuper, -1);
+    for (int s = nsuper - 1; s >= 0; --s)
+    {
+        int p = parent[superStart[s + 1] - 1];
+        if (p != -1)
+        {
+            int ps = colToSuper[p];
+            childNext[s] = childHead[ps];
+            childHead[ps] = s;
+        }
+    }
+
+    std::vector<int> flag(n, -1);
+    for (int s = 0; s < nsuper; ++s)
+    {
+        int f = superStart[s], l = superStart[s + 1] - 1;
+        size_t pos = rowPtr[s];
+        for (int j = f; j <= l; ++j)
+        {
+            rowIdx[pos++] = j;
+            flag[j] = s;
+        }
+        size_t below = pos;
+        for (int j = f; j <= l; ++j)
+        {
+            for (size_t t = colPtr[j]; t < colPtr[j + 1]; ++t)
+            {
+                int i = colRow[t];
+                if (flag[i] != s)
+                {
+                    flag[i] = s;
+                    rowIdx[pos++] = i;
+                }
+            }
+        }
+        for (int c = childHead[s]; c != -1; c = childNext[c])
+        {
+            int wc = superStart[c + 1] - superStart[c];
+            for (size_t t = rowPtr[c] + wc; t < rowPtr[c + 1]; ++t)
+            {
+                int i = rowIdx[t];
+                if (i > l && flag[i] != s)
+                {
+                    flag[i] = s;
+                    rowIdx[pos++] = i;
+                }
+            }
+        }
+        if (pos != rowPtr[s + 1])
+        {
+            throw std::runtime_error("SupernodalCholesky: inconsistent symbolic factorization.");
+        }
+        std::sort(rowIdx.begin() + below, rowIdx.begin() + pos);
+    }
+
+    valPtr.resize(nsuper + 1);
+    valPtr[0] = 0;
+    for (int s = 0; s < nsuper; ++s)
+    {
+        size_t m = rowPtr[s + 1] - rowPtr[s];
+        size_t w = superStart[s + 1] - superStart[s];
+        valPtr[s + 1] = valPtr[s] + m * w;
+    }
+    values.resize(valPtr[nsuper]);
+    work.resize(n);
+    isInitialized = false;
+}
+
+void SupernodalCholesky::compute()
+{
+    if (!A)
+    {
+        throw std::runtime_error("SupernodalCholesky: attach() must be called before compute().");
+    }
+
+    std::vector<int> relMap(n);
+    std::vector<int> head(nsuper, -1), next(nsuper, -1), Lpos(nsuper, 0);
+    std::vector<double> U;
+
+    for (int J = 0; J < nsuper; ++J)
+    {
+        int f = superStart[J];
+        int l = superStart[J + 1] - 1;
+        int w = l - f + 1;
+        int m = rowPtr[J + 1] - rowPtr[J];
+        const int *rows = rowIdx.data + rowPtr[J];
+        double *LJ = values.data + valPtr[J];
+
+        for (int r = 0; r < m; ++r)
+        {
+            relMap[rows[r]] = r;
+        }
+
+        // 把A的对应列散射到块中
+        std::fill(LJ, LJ + (size_t)m * w, 0.0);
+        for (int c = 0; c < w; ++c)
+        {
+            int j = f + c;
+            for (size_t t = colPtr[j]; t < colPtr[j + 1]; ++t)
+            {
+                LJ[relMap[colRow[t]] + (size_t)c * m] += A->elements[colSrc[t]];
+            }
+            LJ[c + (size_t)c * m] += epsilon;
+        }
+
+        // 来自后代超节点的更新
+        int K = head[J];
+        head[J] = -1;
+        while (K != -1)
+        {
+            int nextK = next[K];
+            int mK = rowPtr[K + 1] - rowPtr[K];
+            int wK = superStart[K + 1] - superStart[K];
+            const int *rowsK = rowIdx.data + rowPtr[K];
+            const double *LK = values.data + valPtr[K];
+
+            int p1 = Lpos[K];
+            int p2 = p1;
+            while (p2 < mK && rowsK[p2] <= l)
+            {
+                ++p2;
+            }
+            int mu = mK - p1;
+            int nu = p2 - p1;
+
+            // U = -L_K[p1:mK, :] * L_K[p1:p2, :]^T
+            U.assign((size_t)mu * nu, 0.0);
+            gemmNT(mu, nu, wK, LK + p1, mK, LK + p1, mK, U.data(), mu);
+
+            for (int b = 0; b < nu; ++b)
+            {
+                double *col = LJ + (size_t)(rowsK[p1 + b] - f) * m;
+                const double *u = U.data() + (size_t)b * mu;
+                for (int a = b; a < mu; ++a)
+                {
+                    col[relMap[rowsK[p1 + a]]] += u[a];
+                }
+            }
+
+            Lpos[K] = p2;
+            if (p2 < mK)
+            {
+                int S = colToSuper[rowsK[p2]];
+                next[K] = head[S];
+                head[S] = K;
+            }
+            K = nextK;
+        }
+
+        densePanelCholesky(LJ, m, w);
+
+        Lpos[J] = w;
+        if (w < m)
+        {
+            int S = colToSuper[rows[w]];
+            next[J] = head[S];
+            head[S] = J;
+        }
+    }
+    isInitialized = true;
+}
+
+void SupernodalCholesky::solve(Vec &b, Vec &x)
+{
+    if (!isInitialized)
+    {
+        throw std::runtime_error("SupernodalCholesky: compute() must be called before solve().");
+    }
+
+    double *y = work.data;
+    for (int j = 0; j < n; ++j)
+    {
+        y[j] = b[perm[j]];
+    }
+
+    // L y = P b
+    for (int s = 0; s < nsuper; ++s)
+    {
+        int f = superStart[s];
+        int w = superStart[s + 1] - f;
+        int m = rowPtr[s + 1] - rowPtr[s];
+        const int *rows = rowIdx.data + rowPtr[s];
+        const double *L = values.data + valPtr[s];
+
+        for (int c = 0; c < w; ++c)
+        {
+            const double *lc = L + (size_t)c * m;
+            double yc = y[f + c] / lc[c];
+            y[f + c] = yc;
+            for (int r = c + 1; r < w; ++r)
+            {
+                y[f + r] -= lc[r] * yc;
+            }
+        }
+        for (int r = w; r < m; ++r)
+        {
+            double t = 0.0;
+            for (int c = 0; c < w; ++c)
+            {
+                t += L[r + (size_t)c * m] * y[f + c];
+            }
+            y[rows[r]] -= t;
+        }
+    }
+
+    // L^T z = y
+    for (int s = nsuper - 1; s >= 0; --s)
+    {
+        int f = superStart[s];
+        int w = superStart[s + 1] - f;
+        int m = rowPtr[s + 1] - rowPtr[s];
+        const int *rows = rowIdx.data + rowPtr[s];
+        const double *L = values.data + valPtr[s];
+
+        for (int c = 0; c < w; ++c)
+        {
+            const double *lc = L + (size_t)c * m;
+            double t = 0.0;
+            for (int r = w; r < m; ++r)
+            {
+                t += lc[r] * y[rows[r]];
+            }
+            y[f + c] -= t;
+        }
+        for (int c = w - 1; c >= 0; --c)
+        {
+            const double *lc = L + (size_t)c * m;
+            double t = y[f + c];
+            for (int r = c + 1; r < w; ++r)
+            {
+                t -= lc[r] * y[f + r];
+            }
+            y[f + c] = t / lc[c];
+        }
+    }
+
+    for (int j = 0; j < n; ++j)
+    {
+        x[perm[j]] = y[j];
+    }
+}
+
+void SupernodalCholesky::solve(TArray<Vec> &B, TArray<Vec> &X)
+/* 多个右端项, 每批最多8个交错存储在Yb[i * K + c]中, 超节点的每一块对整批只读取一次 */
+{
+    if (!isInitialized)
+    {
+        throw std::runtime_error("SupernodalCholesky: compute() must be called before solve().");
+    }
+
+    int nrhs = B.size;
+    for (int c0 = 0; c0 < nrhs; c0 += 8)
+    {
+        int k = std::min(8, nrhs - c0);
+        int K = k > 4 ? 8 : (k > 2 ? 4 : k); // 补零到1, 2, 4, 8
+        Yb.resize((size_t)n * K);
+        for (int j = 0; j < n; ++j)
+        {
+            for (int c = 0; c < K; ++c)
+            {
+                Yb[(size_t)j * K + c] = c < k ? B[c0 + c][perm[j]] : 0.0;
+            }
+        }
+
+        switch (K)
+        {
+        case 1:
+            substituteBatch<1>();
+            break;
+        case 2:
+            substituteBatch<2>();
+            break;
+        case 4:
+            substituteBatch<4>();
+            break;
+        default:
+            substituteBatch<8>();
+            break;
+        }
+
+        for (int j = 0; j < n; ++j)
+        {
+            for (int c = 0; c < k; ++c)
+            {
+                X[c0 + c][perm[j]] = Yb[(size_t)j * K + c];
+            }
+        }
+    }
+}
+
+template <int K>
+void SupernodalCholesky::substituteBatch()
+{
+    double *Y = Yb.data;
+
+    // L Y = P B
+    for (int s = 0; s < nsuper; ++s)
+    {
+        int f = superStart[s];
+        int w = superStart[s + 1] - f;
+        int m = rowPtr[s + 1] - rowPtr[s];
+        const int *rows = rowIdx.data + rowPtr[s];
+        const double *L = values.data + valPtr[s];
+
+        for (int col = 0; col < w; ++col)
+        {
+            const double *lc = L + (size_t)col * m;
+            double *yc = Y + (size_t)(f + col) * K;
+            double inv = 1.0 / lc[col];
+            for (int c = 0; c < K; ++c)
+            {
+                yc[c] *= inv;
+            }
+            for (int r = col + 1; r < m; ++r)
+            {
+                double *yr = Y + (size_t)rows[r] * K;
+                for (int c = 0; c < K; ++c)
+                {
+                    yr[c] -= lc[r] * yc[c];
+                }
+            }
+        }
+    }
+
+    // L^T Z = Y
+    for (int s = nsuper - 1; s >= 0; --s)
+    {
+        int f = superStart[s];
+        int w = superStart[s + 1] - f;
+        int m = rowPtr[s + 1] - rowPtr[s];
+        const int *rows = rowIdx.data + rowPtr[s];
+        const double *L = values.data + valPtr[s];
+
+        for (int col = w - 1; col >= 0; --col)
+        {
+            const double *lc = L + (size_t)col * m;
+            double t[K];
+            for (int c = 0; c < K; ++c)
+            {
+                t[c] = Y[(size_t)(f + col) * K + c];
+            }
+            for (int r = col + 1; r < m; ++r)
+            {
+                const double *yr = Y + (size_t)rows[r] * K;
+                for (int c = 0; c < K; ++c)
+                {
+                    t[c] -= lc[r] * yr[c];
+                }
+            }
+            for (int c = 0; c < K; ++c)
+            {
+                Y[(size_t)(f + col) * K + c] = t[c] / lc[col];
+            }
+        }
+    }
+}
+
+size_t SupernodalCholesky::nnzL() const
+{
+    size_t nnz = 0;
+    for (int s = 0; s < nsuper; ++s)
+    {
+        size_t m = rowPtr[s + 1] - rowPtr[s];
+        size_t w = superStart[s + 1] - superStart[s];
+        nnz += m * w - w * (w - 1) / 2;
+    }
+    return nnz;
+}
+
+NAMESPACE_END
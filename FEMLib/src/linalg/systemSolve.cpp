@@ -130,6 +130,61 @@ bool conjugateGradientSolve(Matrix &A, Vec &B, Vec &u, Vec &r, Vec &p, Vec &Ap,
     }
 }
 
+bool conjugateGradientSolve(Matrix &A, Matrix &P, Vec &B, Vec &u, Vec &r, Vec &z, Vec &p, Vec &Ap, double *rel_error, int *iter, double tol, int iterMax)
+/* 预条件共轭梯度法, 与conjugateGradientSolve相同，只是搜索方向由 z = P^{-1} r 生成
+ *      alpha_k = <r_k, z_k> / <p_k, A p_k>
+ *      beta_k = <r_{k+1}, z_{k+1}> / <r_k, z_k>
+ *      p_{k+1} = z_{k+1} + beta_k * p_k
+ */
+{
+    double b2 = dot(B, B);
+
+    A.MVP(u, r);
+    blas_axpby(1.0, B, -1.0, r, r);
+
+    *iter = 0;
+    double r2 = dot(r, r);
+    *rel_error = sqrt(r2 / b2);
+    if (*rel_error <= tol)
+    {
+        return true;
+    }
+
+    P.MVP(r, z);
+    p = z;
+    double rz = dot(r, z);
+
+    while (((*iter)++ < iterMax) && (*rel_error > tol))
+    {
+        A.MVP(p, Ap);
+        double alpha = rz / dot(p, Ap);
+        blas_axpy(alpha, p, u);
+        blas_axpy(-alpha, Ap, r);
+
+        r2 = dot(r, r);
+        *rel_error = sqrt(r2 / b2);
+        if (*rel_error <= tol)
+        {
+            break;
+        }
+
+        P.MVP(r, z);
+        double rz_new = dot(r, z);
+        double beta = rz_new / rz;
+        rz = rz_new;
+        blas_axpby(1.0, z, beta, p, p);
+    }
+
+    if ((*iter) >= iterMax && *rel_error >= tol)
+    {
+        return false;
+    }
+    else
+    {
+        return true;
+    }
+}
+
 /* Since S + M is symmetric and positive definite we can solve
  * the system by the gradient descent method. This is by far
  * not the best method for ill conditionned matrices, but the point
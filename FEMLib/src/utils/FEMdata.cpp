@@ -7,12 +7,28 @@
 #include <systemSolve.h>
 #include <timer.h>
 #include <cholesky.h>
+#include <supernodalCholesky.h>
+#include <MultiGrid.h>
+#include <stdexcept>
 
 NAMESPACE_BEGIN(FEMLib)
 
-FEMData::FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos))
-    : mesh(subdiv, meshtype), A(mesh), u(mesh.vertex_count(), 0.0), B(mesh.vertex_count())
+FEMData::FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos), FEMSolver solver)
+    : FEMData(subdiv, meshtype, func, SKYLINE_CHOLESKY, solver)
 {
+}
+
+FEMData::FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos), CholeskyType choleskyType, FEMSolver solver)
+    : mesh(subdiv, meshtype, true), A(mesh), u(mesh.vertex_count(), 0.0), B(mesh.vertex_count())
+{
+    if (solver != FEM_CHOLESKY && solver != FEM_MG_PCG && solver != FEM_MG_FMG)
+    {
+        throw std::invalid_argument("FEMData: unknown FEMSolver.");
+    }
+    if (solver == FEM_CHOLESKY && choleskyType != SKYLINE_CHOLESKY && choleskyType != SKYLINE_MIXED && choleskyType != SUPERNODAL_CHOLESKY)
+    {
+        throw std::invalid_argument("FEMData: unknown CholeskyType.");
+    }
     Timer t;
     Vec b(mesh.vertex_count());
     for (size_t i = 0; i < mesh.vertex_count(); ++i)
@@ -40,10 +56,37 @@ FEMData::FEMData(int subdiv, MeshType meshtype, double (*func)(Vec3 pos))
 
     t.start();
     // conjugateGradientSolve(A, B, u, r, p, Ap, &rel_error, &iter, tol, iterMax);
-    Cholesky chol;
-    chol.attach(A, 1e-10);
-    chol.compute();
-    chol.solve(B, u);
+    if (solver == FEM_MG_PCG)
+    {
+        // A = S + M 是非奇异的
+        MultiGrid mg(mesh, A);
+        mg.singular = false;
+        Vec z(n);
+        conjugateGradientSolve(A, mg, B, u, r, z, p, Ap, &rel_error, &iter, tol, iterMax);
+    }
+    else if (solver == FEM_MG_FMG)
+    {
+        MultiGrid mg(mesh, A);
+        mg.singular = false;
+        mg.setSmoother(MultiGrid::GAUSS_SEIDEL, 2);
+        mg.fullMultiGrid(B, u);
+        std::cout << "FMG相对残差: " << mg.relError << std::endl;
+    }
+    else if (choleskyType == SUPERNODAL_CHOLESKY)
+    {
+        SupernodalCholesky chol;
+        chol.attach(A, 1e-10);
+        chol.compute();
+        chol.solve(B, u);
+    }
+    else
+    {
+        Cholesky chol;
+        chol.setMixedPrecision(choleskyType == SKYLINE_MIXED);
+        chol.attach(A, 1e-10);
+        chol.compute();
+        chol.solve(B, u);
+    }
 
     t.stop();
     std::cout << "Choleskey求解耗时: " << t.elapsedMilliseconds() << "ms" << std::endl;
@@ -1,153 +1,402 @@
 #include <MultiGrid.h>
 #include <stdexcept>
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <fem.h>
 #include <systemSolve.h>
 #include <timer.h>
+#include <vector>
+#include <algorithm>
 
 NAMESPACE_BEGIN(FEMLib)
 
-MultiGrid::MultiGrid(Mesh &mesh, void funcBuildMatrix(NSMatrix &M))
-    : mt(mesh.meshtype), subdiv(mesh.subdiv), w(0.6),
-      m0(mesh), m1(subdiv / 2, mt, true), m2(subdiv / 4, mt, true), m3(subdiv / 8, mt, true),
-      A0(m0), A1(m1), A2(m2), A3(m3),
-      D0(A0.rows),
-      r0(A0.rows, 0.0), r1(m1.vertex_count(), 0.0), r2(m2.vertex_count(), 0.0), r3(A3.rows, 0.0)
+MGLevel::MGLevel(Mesh &fine)
+    : coarseMesh(), mesh(fine), A(mesh.vertex_count()), P(), R(), D(mesh.vertex_count()), cheb(),
+      x(A.rows, 0.0), b(A.rows, 0.0), r(A.rows, 0.0), t(A.rows, 0.0)
 {
-    tol = 1e-6;
-    // 根据传入的函数构建矩阵
+    resetStats();
+}
+
+MGLevel::MGLevel(int subdiv, MeshType type)
+    : coarseMesh(new Mesh(subdiv, type, true)), mesh(*coarseMesh), A(mesh.vertex_count()), P(), R(), D(mesh.vertex_count()), cheb(),
+      x(A.rows, 0.0), b(A.rows, 0.0), r(A.rows, 0.0), t(A.rows, 0.0)
+{
+    resetStats();
+}
+
+MGLevel::MGLevel(const MGLevel *shared)
+    : coarseMesh(shared->coarseMesh), mesh(shared->mesh), A(mesh.vertex_count()), P(shared->P), R(shared->R), D(mesh.vertex_count()), cheb(),
+      x(A.rows, 0.0), b(A.rows, 0.0), r(A.rows, 0.0), t(A.rows, 0.0)
+{
+    resetStats();
+}
+
+void MGLevel::resetStats() const
+{
+    visits = 0;
+    smoothTime = 0;
+    residualTime = 0;
+    restrictTime = 0;
+    prolongTime = 0;
+    coarseTime = 0;
+}
+
+MultiGrid::MultiGrid(Mesh &mesh, int coarseSize)
+    : Matrix(mesh.vertex_count(), mesh.vertex_count()), mt(mesh.meshtype), subdiv(mesh.subdiv), w(0.6), chebyshevRatio(8.0), tol(1e-6), iterMax(1000), coarseSize(coarseSize), singular(true), verbose(false),
+      smoother(JACOBI), preSmooth(2), postSmooth(2), cycleType(V_CYCLE), iter(0), relError(0), solveTime(0)
+{
+    bool nested = (mt == ICOSPHERE);
+    if (nested ? mesh.parents.size != 2 * mesh.vertex_count()
+               : ((mt != CUBE && mt != SPHERE && mt != EQUIANGULAR_SPHERE) || mesh.dupToNoDupIndex == nullptr))
+    {
+        throw std::invalid_argument("MultiGrid requires a generated cube or sphere mesh with dupToNoDupIndex, or an icosphere.");
+    }
+
+    // 建立各层网格, 二十面体网格每次减少一次细分(顶点数约为1/4), 与subdiv减半相当
+    levels.emplace_back(new MGLevel(mesh));
+    int s = subdiv;
+    while ((int)levels.back()->A.rows > coarseSize && s > (nested ? 0 : 1))
+    {
+        s = nested ? s - 1 : s / 2;
+        levels.emplace_back(new MGLevel(s, mt));
+    }
+
+    // 插值与限制只依赖网格
+    for (int k = 0; k + 1 < numLevels(); ++k)
+    {
+        MGLevel &L = *levels[k];
+        L.P.reset(new CSRMatrix(0));
+        L.R.reset(new CSRMatrix(0));
+        if (nested)
+            buildNestedProlongation(levels[k + 1]->mesh, L.mesh, *L.P);
+        else
+            buildProlongation(levels[k + 1]->mesh, L.mesh, *L.P);
+        transposeMatrix(*L.P, *L.R);
+    }
+}
+
+MultiGrid::MultiGrid(const MultiGrid *hierarchy)
+    : Matrix(hierarchy->rows, hierarchy->cols), mt(hierarchy->mt), subdiv(hierarchy->subdiv), w(0.6), chebyshevRatio(8.0), tol(1e-6), iterMax(1000), coarseSize(hierarchy->coarseSize), singular(true), verbose(false),
+      smoother(JACOBI), preSmooth(2), postSmooth(2), cycleType(V_CYCLE), iter(0), relError(0), solveTime(0)
+{
+    for (const auto &L : hierarchy->levels)
+    {
+        levels.emplace_back(new MGLevel(L.get()));
+    }
+}
+
+MultiGrid::MultiGrid(Mesh &mesh, void funcBuildMatrix(NSMatrix &M), int coarseSize)
+    : MultiGrid(mesh, coarseSize)
+{
+    // 根据传入的函数构建最细一层的矩阵
+    NSMatrix A0(mesh);
     funcBuildMatrix(A0);
-    funcBuildMatrix(A1);
-    funcBuildMatrix(A2);
-    funcBuildMatrix(A3);
+    setMatrix(A0);
+}
 
-    // 构建对角矩阵
-    buildDiagMatrix(A0, D0);
+MultiGrid::MultiGrid(Mesh &mesh, const CSRMatrix &A, int coarseSize)
+    : MultiGrid(mesh, coarseSize)
+{
+    setMatrix(A);
 }
 
-void MultiGrid::projToCoarse(Vec &b, Mesh &m0, Vec &b1, Mesh &m1)
-/* 将b从细网格投影到粗网格上
- * 根据subdiv选取的特性，粗网格的顶点也是细网格的顶点
- * 直接使用对应顶点的值
- */
+void MultiGrid::setMatrix(const CSRMatrix &A)
+// 粗网格上的矩阵为 R A P
 {
-    int subdivFine = m0.subdiv;
-    int subdivCoarse = m1.subdiv;
-    int *dd0 = m0.dupToNoDupIndex;
-    int *dd1 = m1.dupToNoDupIndex;
+    if (A.rows != rows)
+    {
+        throw std::invalid_argument("MultiGrid: the matrix does not match the mesh.");
+    }
+    levels[0]->A = A;
+    for (int k = 0; k < numLevels(); ++k)
+    {
+        MGLevel &L = *levels[k];
+        if (k + 1 < numLevels())
+        {
+            CSRMatrix AP(0);
+            multiplyMatrix(L.A, *L.P, AP);
+            multiplyMatrix(*L.R, AP, levels[k + 1]->A);
+        }
+        buildDiagMatrix(L.A, L.D);
+        buildColoring(L.A, L.colorOffset, L.colorRows);
+        if (smoother == CHEBYSHEV)
+        {
+            L.cheb.attach(L.A);
+            L.cheb.smoothRatio = chebyshevRatio;
+        }
+    }
 
-    int N_fine = subdivFine + 1;
-    int N_coarse = subdivCoarse + 1;
-    int step = subdivFine / subdivCoarse;
+    // 最粗一层的矩阵只在这里分解一次, 与FEMData相同加上epsilon, 奇异时使A正定
+    // singular通常在构造之后才设置, 因此这里不依赖singular
+    MGLevel &C = *levels.back();
+    coarseCholesky.analyze(C.A);
+    coarseCholesky.factorize(C.A, 1e-10);
+}
 
-    // 粗网格中的点 (row_c, col_c) 对应细网格中的点(row_c *step, col_c * step)
-    for (int face = 0; face < 6; ++face)
+void MultiGrid::setSmoother(SmootherType type, int iter)
+{
+    smoother = type;
+    preSmooth = iter;
+    postSmooth = iter;
+    if (type == CHEBYSHEV)
     {
-        int faceOffsetCoarse = face * N_coarse * N_coarse;
-        int faceOffsetFine = face * N_fine * N_fine;
-        // 遍历粗网格的行
-        for (int row_c = 0; row_c < N_coarse; ++row_c)
+        for (auto &L : levels)
         {
-            int row_f = row_c * step;
-            for (int col_c = 0; col_c < N_coarse; ++col_c)
-            {
-                int col_f = col_c * step;
+            // 还没有设置矩阵时在setMatrix中进行
+            if (L->cheb.A != &L->A && L->A.elements.size > 0)
+                L->cheb.attach(L->A);
+            L->cheb.smoothRatio = chebyshevRatio;
+        }
+    }
+}
 
-                int i = faceOffsetCoarse + row_c * N_coarse + col_c;
-                int t = faceOffsetFine + row_f * N_fine + col_f;
+void MultiGrid::setCycle(CycleType type, int pre, int post)
+{
+    cycleType = type;
+    preSmooth = pre;
+    postSmooth = post;
+}
 
-                b1[dd1[i]] = b[dd0[t]];
-            }
+void buildColoring(const CSRMatrix &A, std::vector<size_t> &colorOffset, std::vector<int> &colorRows)
+{
+    int n = A.rows;
+    std::vector<int> color(n, -1);
+    std::vector<int> mark; // mark[c] == i 表示颜色c被第i行的邻点使用
+    int numColors = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        for (size_t k = A.row_offset[i]; k < A.row_offset[i + 1]; ++k)
+        {
+            int c = color[A.elm_idx[k]];
+            if (c >= 0)
+                mark[c] = i;
+        }
+        int c = 0;
+        while (c < numColors && mark[c] == i)
+            ++c;
+        if (c == numColors)
+        {
+            mark.push_back(-1);
+            ++numColors;
         }
+        color[i] = c;
+    }
+
+    colorOffset.assign(numColors + 1, 0);
+    for (int i = 0; i < n; ++i)
+    {
+        colorOffset[color[i] + 1]++;
+    }
+    for (int c = 0; c < numColors; ++c)
+    {
+        colorOffset[c + 1] += colorOffset[c];
+    }
+    colorRows.resize(n);
+    std::vector<size_t> pos(colorOffset.begin(), colorOffset.end() - 1);
+    for (int i = 0; i < n; ++i)
+    {
+        colorRows[pos[color[i]]++] = i;
     }
 }
 
-void MultiGrid::projToFine(Vec &b, Mesh &m0, Vec &b1, Mesh &m1)
-// 将b从粗网格投影到细网格
+void buildNestedProlongation(const Mesh &coarse, const Mesh &fine, CSRMatrix &P)
+// 粗网格的点是细网格的前 nc 个点, 插值为1; 新的点是一条粗网格边的中点, 两个端点各为0.5
 {
-    int subdivFine = m1.subdiv;
-    int subdivCoarse = m0.subdiv;
-    int *ddFine = m1.dupToNoDupIndex;
-    int *ddCoarse = m0.dupToNoDupIndex;
+    int nf = fine.vertex_count();
+    int nc = coarse.vertex_count();
+    P.rows = nf;
+    P.cols = nc;
+    P.row_offset.resize(nf + 1);
+    P.elm_idx.resize(nc + 2 * (size_t)(nf - nc));
+    P.elements.resize(nc + 2 * (size_t)(nf - nc));
+    P.row_offset[0] = 0;
+#pragma omp parallel for
+    for (int v = 0; v < nf; ++v)
+    {
+        if (v < nc)
+        {
+            P.row_offset[v + 1] = v + 1;
+            P.elm_idx[v] = v;
+            P.elements[v] = 1.0;
+        }
+        else
+        {
+            size_t p = nc + 2 * (size_t)(v - nc);
+            int a = fine.parents[2 * v], b = fine.parents[2 * v + 1];
+            P.row_offset[v + 1] = p + 2;
+            P.elm_idx[p] = std::min(a, b);
+            P.elm_idx[p + 1] = std::max(a, b);
+            P.elements[p] = 0.5;
+            P.elements[p + 1] = 0.5;
+        }
+    }
+}
 
-    int N_Fine = subdivFine + 1;
-    int N_Coarse = subdivCoarse + 1;
-    int step = subdivFine / subdivCoarse;
+void buildProlongation(const Mesh &coarse, const Mesh &fine, CSRMatrix &P)
+/* 细网格面上的点 (row_f, col_f) 位于粗网格参数域中的 (row_f * sc / sf, col_f * sc / sf)
+ * 所在四边形的左下角为 (r0, c0), 局部坐标 dy, dx 由整数计算得到
+ * 面1, 2, 4的四边形沿 (r0, c0)-(r0 + 1, c0 + 1) 分割, 其余的面沿 (r0, c0 + 1)-(r0 + 1, c0) 分割
+ * 在所在的三角形上做线性插值, 每一行最多3个非零元素
+ * 不同面上的重复点只由第一次出现的位置写入
+ */
+{
+    int sf = fine.subdiv;
+    int sc = coarse.subdiv;
+    const int *ddFine = fine.dupToNoDupIndex;
+    const int *ddCoarse = coarse.dupToNoDupIndex;
+    int N_Fine = sf + 1;
+    int N_Coarse = sc + 1;
+    int nf = fine.vertex_count();
+    int nc = coarse.vertex_count();
+
+    std::vector<int> owner(nf, -1);
+    for (int t = 0; t < 6 * N_Fine * N_Fine; ++t)
+    {
+        if (owner[ddFine[t]] < 0)
+            owner[ddFine[t]] = t;
+    }
 
+    std::vector<int> idx(3 * nf, -1);
+    std::vector<double> val(3 * nf, 0.0);
     for (int face = 0; face < 6; ++face)
     {
         int faceOffsetCoarse = face * N_Coarse * N_Coarse;
         int faceOffsetFine = face * N_Fine * N_Fine;
+        bool mainDiagonal = (face == 1 || face == 2 || face == 4);
 
+#pragma omp parallel for
         for (int row_f = 0; row_f < N_Fine; ++row_f)
         {
-            // 计算当前行对应的粗网格行，以及上下两行
-            float row_c_f = (float)row_f / step;
-            int row_c0 = (int)std::floor(row_c_f);           // 细网格行对应的粗网格的下方一行
-            int row_c1 = std::min(row_c0 + 1, N_Coarse - 1); // 上方一行，需要避免超出范围
-            float dy = row_c_f - row_c0;                     // 用于双线性插值
-
+            int r0 = std::min(row_f * sc / sf, sc - 1);
+            double dy = (double)(row_f * sc - r0 * sf) / sf;
             for (int col_f = 0; col_f < N_Fine; ++col_f)
             {
-                // 类似的计算当前列对应的粗网格的列
-                float col_c_f = (float)col_f / step;
-                int col_c0 = (int)std::floor(col_c_f);
-                int col_c1 = std::min(col_c0 + 1, N_Coarse - 1);
-                float dx = col_c_f - col_c0;
-
                 int t = faceOffsetFine + row_f * N_Fine + col_f;
-                int idx_f = ddFine[t];
+                int v = ddFine[t];
+                if (owner[v] != t)
+                    continue;
 
-                if (row_f % step == 0 && col_f % step == 0) // 细网格点与粗网格点重合，直接使用粗网格的值
+                int c0 = std::min(col_f * sc / sf, sc - 1);
+                double dx = (double)(col_f * sc - c0 * sf) / sf;
+
+                int i00 = ddCoarse[faceOffsetCoarse + r0 * N_Coarse + c0];
+                int i01 = ddCoarse[faceOffsetCoarse + r0 * N_Coarse + c0 + 1];
+                int i10 = ddCoarse[faceOffsetCoarse + (r0 + 1) * N_Coarse + c0];
+                int i11 = ddCoarse[faceOffsetCoarse + (r0 + 1) * N_Coarse + c0 + 1];
+
+                int *id = &idx[3 * v];
+                double *w = &val[3 * v];
+                if (mainDiagonal)
                 {
-                    int i = faceOffsetCoarse + row_c0 * N_Coarse + col_c0;
-                    b1[idx_f] = b[ddCoarse[i]];
+                    if (dx >= dy)
+                    {
+                        id[0] = i00, w[0] = 1 - dx;
+                        id[1] = i01, w[1] = dx - dy;
+                        id[2] = i11, w[2] = dy;
+                    }
+                    else
+                    {
+                        id[0] = i00, w[0] = 1 - dy;
+                        id[1] = i10, w[1] = dy - dx;
+                        id[2] = i11, w[2] = dx;
+                    }
                 }
                 else
                 {
-                    // 使用双线性插值
-                    int i00 = faceOffsetCoarse + row_c0 * N_Coarse + col_c0;
-                    int i01 = faceOffsetCoarse + row_c1 * N_Coarse + col_c0;
-                    int i10 = faceOffsetCoarse + row_c0 * N_Coarse + col_c1;
-                    int i11 = faceOffsetCoarse + row_c1 * N_Coarse + col_c1;
-
-                    int idx00 = ddCoarse[i00];
-                    int idx01 = ddCoarse[i01];
-                    int idx10 = ddCoarse[i10];
-                    int idx11 = ddCoarse[i11];
-
-                    double v00 = b[idx00];
-                    double v01 = b[idx01];
-                    double v10 = b[idx10];
-                    double v11 = b[idx11];
-
-                    // 双线性插值，先对x进行插值，再对y进行插值
-                    double v0 = v00 * (1 - dx) + v10 * dx;
-                    double v1 = v01 * (1 - dx) + v11 * dx;
-                    double v = v0 * (1 - dy) + v1 * dy;
-
-                    b1[idx_f] = v;
+                    if (dx + dy <= 1)
+                    {
+                        id[0] = i00, w[0] = 1 - dx - dy;
+                        id[1] = i01, w[1] = dx;
+                        id[2] = i10, w[2] = dy;
+                    }
+                    else
+                    {
+                        id[0] = i11, w[0] = dx + dy - 1;
+                        id[1] = i01, w[1] = 1 - dy;
+                        id[2] = i10, w[2] = 1 - dx;
+                    }
                 }
             }
         }
     }
+
+    // 去掉为零的权重, 按列排序后写入CSR
+    P.rows = nf;
+    P.cols = nc;
+    P.row_offset.resize(nf + 1);
+    P.row_offset[0] = 0;
+    for (int v = 0; v < nf; ++v)
+    {
+        int count = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            count += (val[3 * v + k] != 0.0);
+        }
+        P.row_offset[v + 1] = P.row_offset[v] + count;
+    }
+    P.elm_idx.resize(P.row_offset[nf]);
+    P.elements.resize(P.row_offset[nf]);
+#pragma omp parallel for
+    for (int v = 0; v < nf; ++v)
+    {
+        int order[3] = {0, 1, 2};
+        std::sort(order, order + 3, [&](int a, int b)
+                  { return idx[3 * v + a] < idx[3 * v + b]; });
+        size_t p = P.row_offset[v];
+        for (int k : order)
+        {
+            if (val[3 * v + k] != 0.0)
+            {
+                P.elm_idx[p] = idx[3 * v + k];
+                P.elements[p] = val[3 * v + k];
+                ++p;
+            }
+        }
+    }
 }
 
-void MultiGrid::dumpedJacobi(const NSMatrix &A, const diagMatrix &D, const Vec &b, Vec &x, Vec &r, int iter = 5)
+void MultiGrid::dumpedJacobi(const CSRMatrix &A, const diagMatrix &D, const Vec &b, Vec &x, Vec &r, Vec &t, int iter) const
 {
-    Vec p(x.size); // 临时空间
-
     for (int i = 0; i < iter; ++i)
     {
-        A.MVP(x, p);
-        blas_axpby(1.0, b, -1.0, p, r); // r = b - Ax
-        D.MVP_inverse(r, p);
-        blas_axpby(1.0, x, w, p, x); // x = x + w * D^-1 * r
+        A.MVP(x, t);
+        blas_axpby(1.0, b, -1.0, t, r); // r = b - Ax
+        D.MVP_inverse(r, t);
+        blas_axpby(1.0, x, w, t, x); // x = x + w * D^-1 * r
     }
 }
 
-void MultiGrid::conjugateGraidentSmooth(NSMatrix &A, Vec &b, Vec &x, int iter = 5)
+void MultiGrid::gaussSeidel(const MGLevel &L, const Vec &b, Vec &x, int iter) const
+/* 对称Gauss-Seidel: 按颜色 0, 1, ..., C - 1 正向一遍, 再按 C - 1, ..., 0 反向一遍
+ * 同一颜色的行互不相邻, 可以并行地原地更新 x_i = (b_i - sum_{j != i} a_ij x_j) / a_ii
+ */
+{
+    const CSRMatrix &A = L.A;
+    int numColors = L.colorOffset.size() - 1;
+    for (int it = 0; it < iter; ++it)
+    {
+        for (int s = 0; s < 2 * numColors; ++s)
+        {
+            int c = (s < numColors) ? s : 2 * numColors - 1 - s;
+            size_t begin = L.colorOffset[c];
+            size_t end = L.colorOffset[c + 1];
+#pragma omp parallel for
+            for (long q = begin; q < (long)end; ++q)
+            {
+                int i = L.colorRows[q];
+                double sum = b[i];
+                for (size_t k = A.row_offset[i]; k < A.row_offset[i + 1]; ++k)
+                {
+                    sum -= A.elements[k] * x[A.elm_idx[k]];
+                }
+                x[i] += sum / L.D.diag[i];
+            }
+        }
+    }
+}
+
+void MultiGrid::conjugateGraidentSmooth(CSRMatrix &A, Vec &b, Vec &x, int iter = 5)
 {
     int cg_iter;
     double cg_rel_error;
@@ -155,57 +404,202 @@ void MultiGrid::conjugateGraidentSmooth(NSMatrix &A, Vec &b, Vec &x, int iter =
     conjugateGradientSolve(A, b, x, r, p, Ap, &cg_rel_error, &cg_iter, tol, iter);
 }
 
+void MultiGrid::smooth(int k, const Vec &b, Vec &x, int iter) const
+{
+    MGLevel &L = *levels[k];
+    if (smoother == CHEBYSHEV)
+    {
+        L.cheb.smooth(b, x, iter);
+    }
+    else if (smoother == GAUSS_SEIDEL)
+    {
+        gaussSeidel(L, b, x, iter);
+    }
+    else
+    {
+        dumpedJacobi(L.A, L.D, b, x, L.r, L.t, iter);
+    }
+}
+
+void MultiGrid::coarseSolve(MGLevel &L) const
+// 最粗一层 Ae = r 直接用setMatrix中得到的分解求解
+{
+    Timer timer;
+    if (singular)
+    {
+        setZeroMean(L.b);
+    }
+    coarseCholesky.solve(L.b, L.x);
+    if (singular)
+    {
+        setZeroMean(L.x);
+    }
+    L.coarseTime += timer.elapsedMilliseconds();
+}
+
+void MultiGrid::cycle(int k, CycleType type) const
+/* 在第k层:
+ * 预平滑后计算残差，将残差限制到下一层网格，在下一层求解Ae = r得到误差e
+ * 将e插值回到本层，更新x = x + e, 再进行后平滑
+ */
+{
+    MGLevel &L = *levels[k];
+    L.visits++;
+    if (k + 1 == numLevels())
+    {
+        coarseSolve(L);
+        return;
+    }
+    MGLevel &C = *levels[k + 1];
+
+    Timer timer;
+    smooth(k, L.b, L.x, preSmooth);
+    L.smoothTime += timer.elapsedMilliseconds();
+
+    timer.start();
+    L.A.MVP(L.x, L.t);
+    blas_axpby(1.0, L.b, -1.0, L.t, L.r); // 计算残差
+    L.residualTime += timer.elapsedMilliseconds();
+
+    timer.start();
+    L.R->MVP(L.r, C.b);
+    C.x.setAll(0.0);
+    L.restrictTime += timer.elapsedMilliseconds();
+
+    switch (type)
+    {
+    case V_CYCLE:
+        cycle(k + 1, V_CYCLE);
+        break;
+    case W_CYCLE:
+        cycle(k + 1, W_CYCLE);
+        cycle(k + 1, W_CYCLE);
+        break;
+    case F_CYCLE:
+        cycle(k + 1, F_CYCLE);
+        cycle(k + 1, V_CYCLE);
+        break;
+    }
+
+    timer.start();
+    L.P->MVP(C.x, L.t);
+    if (singular && k == 0)
+    {
+        setZeroMean(L.t);
+    }
+    blas_axpby(1.0, L.x, 1.0, L.t, L.x);
+    L.prolongTime += timer.elapsedMilliseconds();
+
+    timer.start();
+    smooth(k, L.b, L.x, postSmooth);
+    L.smoothTime += timer.elapsedMilliseconds();
+}
+
 /* 我们希望在最细网格上求解Ax = b
- * 预平滑后计算残差，将残差限制到下一层网格，求解Ae = r得到误差e
- * 将e插值回到细网格，更新x = x + e
+ * 以x为初值反复进行cycleType的循环, 直到相对残差小于tol
  */
-void MultiGrid::solve(Vec &b, Vec &x)
+void MultiGrid::solve(const Vec &b, Vec &x)
 {
+    Timer timer;
+    MGLevel &L = *levels[0];
     double b_norm = b.norm();
-    double rel_error;
-    int iter = 0;
-    int iterMax = 1000;
-    Vec p0(x.size);
-    Vec p3(r3.size), Ap3(r3.size), t3(r3.size);
-    Vec e3(r3.size, 0.0), e2(r2.size, 0.0), e1(r1.size, 0.0);
-    while (iter++ < iterMax)
+    std::copy(b.begin(), b.end(), L.b.begin());
+    std::copy(x.begin(), x.end(), L.x.begin());
+
+    iter = 0;
+    L.A.MVP(L.x, L.t);
+    blas_axpby(1.0, L.b, -1.0, L.t, L.r);
+    relError = (b_norm > 0) ? L.r.norm() / b_norm : 0.0;
+    while (relError > tol && iter < iterMax)
     {
-        // 计算残差并限制
-        // conjugateGraidentSmooth(A0, b, x, 10); // 预平滑
-        dumpedJacobi(A0, D0, b, x, r0);
+        cycle(0, cycleType);
+        ++iter;
+
+        L.A.MVP(L.x, L.t);
+        blas_axpby(1.0, L.b, -1.0, L.t, L.r);
+        relError = L.r.norm() / b_norm;
+        if (verbose)
+            std::cout << "iter :" << iter << " rel_error: " << relError << std::endl;
+    }
+    std::copy(L.x.begin(), L.x.end(), x.begin());
+    solveTime = timer.elapsedMilliseconds();
+}
 
-        A0.MVP(x, p0);
-        blas_axpby(1.0, b, -1.0, p0, r0); // 计算残差
-        rel_error = r0.norm() / b_norm;
-        std::cout << "iter :" << iter << " rel_error: " << rel_error << std::endl;
+/* FMG: 由粗到细, 每一层以上一层的解的插值为初值做cycles次V循环
+ * 粗网格的右端项为 R b, 与Galerkin算子 R A P 相容
+ * P的行和为1, R = P^T 保持右端项的和不变, singular时各层的右端项仍为零均值
+ */
+void MultiGrid::fullMultiGrid(const Vec &b, Vec &x, int cycles)
+{
+    Timer timer;
+    int nl = numLevels();
+    std::copy(b.begin(), b.end(), levels[0]->b.begin());
+    for (int k = 0; k + 1 < nl; ++k)
+    {
+        levels[k]->R->MVP(levels[k]->b, levels[k + 1]->b);
+    }
 
-        if (rel_error < this->tol)
-            break;
+    coarseSolve(*levels[nl - 1]);
+    for (int k = nl - 2; k >= 0; --k)
+    {
+        MGLevel &L = *levels[k];
+        // cycle会覆盖下一层的b与x, 因此先插值
+        L.P->MVP(levels[k + 1]->x, L.x);
+        for (int c = 0; c < cycles; ++c)
+        {
+            cycle(k, V_CYCLE);
+        }
+    }
 
-        projToCoarse(r0, m0, r1, m1); // 限制到粗网格m1
-        projToCoarse(r1, m1, r2, m2);
-        projToCoarse(r2, m2, r3, m3);
-        setZeroMean(r3);
+    MGLevel &L = *levels[0];
+    if (singular)
+    {
+        setZeroMean(L.x);
+    }
+    std::copy(L.x.begin(), L.x.end(), x.begin());
 
-        // 在最粗网格上直接求解Ae = r
-        int cg_iter;
-        double cg_rel_error;
-        conjugateGradientSolve(A3, r3, e3, t3, p3, Ap3, &cg_rel_error, &cg_iter, tol);
-        // std::cout << "cg_rel_error: " << cg_rel_error << std::endl;
+    iter = cycles;
+    double b_norm = b.norm();
+    L.A.MVP(L.x, L.t);
+    blas_axpby(1.0, L.b, -1.0, L.t, L.r);
+    relError = (b_norm > 0) ? L.r.norm() / b_norm : 0.0;
+    solveTime = timer.elapsedMilliseconds();
+}
 
-        // 插值回到细网格
-        projToFine(e3, m3, e2, m2);
-        projToFine(e2, m2, e1, m1);
-        projToFine(e1, m1, p0, m0);
-        setZeroMean(p0);
-        blas_axpby(1.0, x, 1.0, p0, x);
+void MultiGrid::MVP(const Vec &x, Vec &y) const
+{
+    MGLevel &L = *levels[0];
+    std::copy(x.begin(), x.end(), L.b.begin());
+    L.x.setAll(0.0);
+    cycle(0, cycleType);
+    std::copy(L.x.begin(), L.x.end(), y.begin());
+}
+
+void MultiGrid::printStats() const
+{
+    std::ios old_state(nullptr);
+    old_state.copyfmt(std::cout);
 
-        // conjugateGraidentSmooth(A0, b, x, 10); // 后平滑
-        dumpedJacobi(A0, D0, b, x, r0);
+    std::cout << "level  subdiv  rows      visits  smooth(ms)  residual(ms)  restrict(ms)  prolong(ms)  coarse(ms)" << std::endl;
+    for (int k = 0; k < numLevels(); ++k)
+    {
+        const MGLevel &L = *levels[k];
+        std::cout << std::left << std::setw(7) << k << std::setw(8) << L.mesh.subdiv << std::setw(10) << L.A.rows << std::setw(8) << L.visits
+                  << std::fixed << std::setprecision(3) << std::setw(12) << L.smoothTime << std::setw(14) << L.residualTime
+                  << std::setw(14) << L.restrictTime << std::setw(13) << L.prolongTime << std::setw(10) << L.coarseTime << std::endl;
+    }
+    std::cout.copyfmt(old_state);
+}
+
+void MultiGrid::resetStats() const
+{
+    for (auto &L : levels)
+    {
+        L->resetStats();
     }
 }
 
-void MultiGrid::setZeroMean(Vec &x)
+void MultiGrid::setZeroMean(Vec &x) const
 {
     double mean = x.sum() / (double)x.size;
 
@@ -215,33 +609,4 @@ void MultiGrid::setZeroMean(Vec &x)
     }
 }
 
-// void MultiGrid::solve(Vec &b, Vec &x)
-// {
-//     Vec x1(A1.rows, 0.0), x2(A2.rows, 0.0), x3(A3.rows, 0.0);
-//     Vec p1(A1.rows, 0.0), p2(A2.rows, 0.0), p3(A3.rows, 0.0);
-//     Vec Ap1(A1.rows, 0.0), Ap2(A2.rows, 0.0), Ap3(A3.rows, 0.0);
-//     Vec b1(A1.rows, 0.0), b2(A2.rows, 0.0), b3(A3.rows, 0.0);
-//     Vec p0(x.size), Ap0(x.size);
-//     projToCoarse(b, m0, b1, m1);
-//     projToCoarse(b, m0, b2, m2);
-//     projToCoarse(b, m0, b3, m3);
-//     setZeroMean(b1);
-//     setZeroMean(b2);
-//     setZeroMean(b3);
-
-//     double rel_err;
-//     int iter;
-//     conjugateGradientSolve(A3, b3, x3, r3, p3, Ap3, &rel_err, &iter, tol, 10000);
-//     std::cout << "iter: " << iter << " rel_err: " << rel_err <<std::endl;
-//     projToFine(x3, m3, x2, m2);
-//     conjugateGradientSolve(A2, b2, x2, r2, p2, Ap2, &rel_err, &iter, tol, 10000);
-//     std::cout << "iter: " << iter << " rel_err: " << rel_err <<std::endl;
-//     projToFine(x2, m2, x1, m1);
-//     conjugateGradientSolve(A1, b1, x1, r1, p1, Ap1, &rel_err, &iter, tol, 10000);
-//     std::cout << "iter: " << iter << " rel_err: " << rel_err << std::endl;
-//     projToFine(x1, m1, x, m0);
-//     conjugateGradientSolve(A0, b, x, r0, p0, Ap0, &rel_err, &iter, tol, 10000);
-//     std::cout << "iter: " << iter << " rel_err: " << rel_err << std::endl;
-// }
-
-NAMESPACE_END
\ No newline at end of file
+NAMESPACE_END
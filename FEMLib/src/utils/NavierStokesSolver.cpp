@@ -7,20 +7,121 @@
 #include <systemSolve.h>
 #include <iostream>
 #include <timer.h>
+#include <cmath>
+#include <string>
+#include <matrixCache.h>
+#include <stdexcept>
 
 NAMESPACE_BEGIN(FEMLib)
 
-NavierStokesSolver::NavierStokesSolver(int subdiv, MeshType meshtype)
+NavierStokesSolver::NavierStokesSolver(int subdiv, MeshType meshtype, StreamSolver streamSolver)
+    : NavierStokesSolver(subdiv, meshtype, SKYLINE_CHOLESKY, streamSolver)
+{
+}
+
+NavierStokesSolver::NavierStokesSolver(int subdiv, MeshType meshtype, CholeskyType choleskyType, StreamSolver streamSolver)
     : mesh(subdiv, meshtype, true), M(mesh), S(mesh), A(mesh), Omega(M.rows, 0), MOmega(M.rows, 0), Psi(M.rows, 0), T(M.rows, 0), r(M.rows, 0), p(M.rows, 0), Ap(M.rows, 0),
-      cholesky()
+      streamSolver(streamSolver), choleskyType(choleskyType), cholesky(), snCholesky(), z(M.rows, 0), omegaGuess(M.rows), Ax0(M.rows, 0), AOmega(M.rows, 0), dtnu(-1), omegaIter(0), omegaIterTotal(0), omegaIterSaved(0), omegaLogReduction(0), omegaLogIter(0),
+      omegaDCG(M.rows, 0, 0), useDeflation(false), directOmega(false), omegaCholesky(),
+      Aop(A, "ns_" + std::to_string(meshtype) + "_" + std::to_string(subdiv) + "_A", true)
 {
     t = 0;
     tol = 1e-6;
-    buildMassMatrix(M);
-    buildStiffnessMatrix(S);
+    if (streamSolver != STREAM_CHOLESKY && streamSolver != STREAM_MG_PCG)
+    {
+        throw std::invalid_argument("NavierStokesSolver: unknown StreamSolver.");
+    }
+    if (choleskyType != SKYLINE_CHOLESKY && choleskyType != SKYLINE_MIXED && choleskyType != SUPERNODAL_CHOLESKY)
+    {
+        throw std::invalid_argument("NavierStokesSolver: unknown CholeskyType.");
+    }
+
+    /* 设置了FEMLIB_CACHE_DIR时, M, S以及S的分解(skyline或超节点)从缓存中读取
+     * M, S的key为网格的哈希, 分解的key为S的哈希与epsilon
+     * 组装与分解的代码改变时, 文件头中的构建标识不同, 缓存自动失效
+     */
+    std::string dir = cacheDirectory();
+    std::string prefix;
+    uint64_t meshKey = 0;
+    if (!dir.empty())
+    {
+        prefix = dir + "/ns_" + std::to_string(meshtype) + "_" + std::to_string(subdiv) + "_";
+        meshKey = hashMesh(mesh);
+    }
+    if (prefix.empty() || !loadCSR(prefix + "M.bin", M, meshKey))
+    {
+        buildMassMatrix(M);
+        if (!prefix.empty())
+            saveCSR(prefix + "M.bin", M, meshKey);
+    }
+    if (prefix.empty() || !loadCSR(prefix + "S.bin", S, meshKey))
+    {
+        buildStiffnessMatrix(S);
+        if (!prefix.empty())
+            saveCSR(prefix + "S.bin", S, meshKey);
+    }
     vol = M.elements.sum();
-    cholesky.attach(S, 1e-10);
-    cholesky.compute();
+
+    if (meshtype == CUBE || meshtype == SPHERE || meshtype == EQUIANGULAR_SPHERE)
+    {
+        Astencil.reset(new StencilMatrix(mesh, 1.0, 0.0));
+        Aop.addFormat("stencil", Astencil.get());
+    }
+
+    double epsilon = 1e-10;
+    if (streamSolver == STREAM_MG_PCG)
+    {
+        psiMG.reset(new MultiGrid(mesh, S));
+        omegaMG.reset(new MultiGrid(psiMG.get())); // 与psiMG共享各层网格与插值
+        omegaMG->singular = false;
+    }
+    else if (choleskyType == SUPERNODAL_CHOLESKY)
+    {
+        std::string path = prefix + "supernodal.bin";
+        uint64_t key = fnv1a(&epsilon, sizeof(epsilon), hashMatrix(S));
+        if (prefix.empty() || !loadSupernodalCholesky(path, snCholesky, S, epsilon, key))
+        {
+            snCholesky.attach(S, epsilon);
+            snCholesky.compute();
+            if (!prefix.empty())
+                saveSupernodalCholesky(path, snCholesky, key);
+        }
+    }
+    else
+    {
+        cholesky.setMixedPrecision(choleskyType == SKYLINE_MIXED);
+        std::string path = prefix + (choleskyType == SKYLINE_MIXED ? "cholesky_mixed.bin" : "cholesky.bin");
+        uint64_t key = fnv1a(&epsilon, sizeof(epsilon), hashMatrix(S));
+        if (prefix.empty() || !loadCholesky(path, cholesky, S, epsilon, key))
+        {
+            cholesky.attach(S, epsilon);
+            cholesky.compute();
+            if (!prefix.empty())
+                saveCholesky(path, cholesky, key);
+        }
+    }
+}
+
+void NavierStokesSolver::setInitialGuess(InitialGuess::Mode mode, int history)
+{
+    omegaGuess = InitialGuess(M.rows, mode, history);
+}
+
+void NavierStokesSolver::setDeflation(int k, int l)
+{
+    useDeflation = k > 0;
+    omegaDCG = DeflatedCG(M.rows, k, l);
+}
+
+void NavierStokesSolver::setDirectOmega(bool direct)
+{
+    directOmega = direct;
+    omegaGuess.reset(); // 直接法求解的步不加入历史, AOmega不再对应当前的Omega
+    if (direct)
+    {
+        omegaCholesky.analyze(A);
+        dtnu = -1; // 下一步重新组装A并分解
+    }
 }
 
 void NavierStokesSolver::computeStream(int *iter)
@@ -28,7 +129,21 @@ void NavierStokesSolver::computeStream(int *iter)
     M.MVP(Omega, MOmega);
     MOmega.scaleInPlace(-1.0);
     setZeroMean(MOmega);
-    cholesky.solve(MOmega, Psi);
+    if (streamSolver == STREAM_MG_PCG)
+    {
+        // S的核为常数, 右端项需要与常数正交
+        double rel_error;
+        psiMG->setZeroMean(MOmega);
+        conjugateGradientSolve(S, *psiMG, MOmega, Psi, r, z, p, Ap, &rel_error, iter, tol, 1000);
+    }
+    else if (choleskyType == SUPERNODAL_CHOLESKY)
+    {
+        snCholesky.solve(MOmega, Psi);
+    }
+    else
+    {
+        cholesky.solve(MOmega, Psi);
+    }
 
     // Vec tmpM = MOmega;
     // Vec tmpPsi = Psi;
@@ -90,11 +205,86 @@ void NavierStokesSolver::timeStep(double dt, double nu)
     M.MVP(Omega, p);
     blas_axpby(1.0, p, dt, T, MOmega);
     // MOmega = MOmega + dt * T;
-    blas_addMatrix(S, dt * nu, M, A);
-    // A = M + dt * nu * S
+    if (dt * nu != dtnu)
+    {
+        blas_addMatrix(S, dt * nu, M, A);
+        // A = M + dt * nu * S
+        dtnu = dt * nu;
+        if (Astencil)
+        {
+            Astencil->setCoefficients(1.0, dtnu);
+        }
+        Aop.update();
+        omegaGuess.reset();
+        omegaDCG.refresh(Aop);
+        if (omegaMG)
+        {
+            omegaMG->setMatrix(A);
+        }
+        if (directOmega)
+        {
+            // 非零结构不变, 只需要重新做数值分解
+            omegaCholesky.factorize(A);
+        }
+    }
+
+    if (directOmega)
+    {
+        omegaCholesky.solve(MOmega, Omega);
+        omegaIter = 0;
+    }
+    else
+    {
+        // 使用历史解构造初值, 并与上一步的解作为初值时的残差比较
+        double r_prev = 0, r_guess = 0;
+        if (omegaGuess.guess(MOmega, p, Ax0))
+        {
+            blas_axpby(1.0, MOmega, -1.0, AOmega, Ap);
+            r_prev = Ap.norm();
+            blas_axpby(1.0, MOmega, -1.0, Ax0, Ax0);
+            r_guess = Ax0.norm();
+            if (r_guess < r_prev)
+            {
+                std::copy(p.begin(), p.end(), Omega.begin());
+            }
+            else
+            {
+                r_guess = r_prev;
+            }
+        }
 
-    conjugateGradientSolve(A, MOmega, Omega, r, p, Ap, &rel_error, &iter2, tol, 1000);
+        if (useDeflation)
+        {
+            omegaDCG.solve(Aop, MOmega, Omega, r, p, Ap, &rel_error, &iter2, tol, 1000);
+        }
+        else if (omegaMG)
+        {
+            conjugateGradientSolve(Aop, *omegaMG, MOmega, Omega, r, z, p, Ap, &rel_error, &iter2, tol, 1000);
+        }
+        else
+        {
+            conjugateGradientSolve(Aop, MOmega, Omega, r, p, Ap, &rel_error, &iter2, tol, 1000);
+        }
+        omegaIter = iter2;
+        omegaIterTotal += iter2;
+        if (r_guess > 0 && iter2 > 0)
+        {
+            // 使用整个运行过程中平均每次迭代的残差下降量估计收敛速率
+            double r_final = rel_error * MOmega.norm();
+            omegaLogReduction += std::log(r_guess / r_final);
+            omegaLogIter += iter2;
+            if (r_prev > r_guess && omegaLogReduction > 0)
+            {
+                omegaIterSaved += std::log(r_prev / r_guess) * omegaLogIter / omegaLogReduction;
+            }
+        }
+    }
     setZeroMean(Omega);
+    if (!directOmega)
+    {
+        // 去掉均值之后再加入历史, 同时得到下一步使用的 A * Omega
+        omegaGuess.update(Aop, Omega, AOmega);
+    }
     t += dt;
     // std::cout << "Iter2: " << iter2;
     // timer.stop(" total time");
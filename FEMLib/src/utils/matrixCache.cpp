@@ -0,0 +1,354 @@
+#include <matrixCache.h>
+#include <CSRMatrix.h>
+#include <SKRMatrix.h>
+#include <cholesky.h>
+#include <supernodalCholesky.h>
+#include <buildId.h>
+#include <Mesh.h>
+#include <TArray.h>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+NAMESPACE_BEGIN(FEMLib)
+
+static const size_t CACHE_ALIGN = 64;
+static const char CACHE_MAGIC[8] = "FEMLIBC";
+
+uint64_t fnv1a(const void *data, size_t bytes, uint64_t h)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t hashMesh(const Mesh &mesh)
+{
+    uint64_t h = fnv1a(mesh.vertices.data, mesh.vertices.size * sizeof(Vec3));
+    return fnv1a(mesh.indices.data, mesh.indices.size * sizeof(uint32_t), h);
+}
+
+uint64_t hashMatrix(const CSRMatrix &A)
+{
+    uint64_t h = fnv1a(&A.rows, sizeof(A.rows));
+    h = fnv1a(A.row_offset.data, A.row_offset.size * sizeof(size_t), h);
+    h = fnv1a(A.elm_idx.data, A.elm_idx.size * sizeof(size_t), h);
+    return fnv1a(A.elements.data, A.elements.size * sizeof(double), h);
+}
+
+uint64_t cacheBuildId()
+{
+    return FEMLIB_BUILD_ID;
+}
+
+std::string cacheDirectory()
+{
+    const char *dir = std::getenv("FEMLIB_CACHE_DIR");
+    return dir ? std::string(dir) : std::string();
+}
+
+struct CacheSection
+{
+    const void *data;
+    size_t bytes;
+};
+
+static bool writeCache(const std::string &path, const CacheHeader &header, const std::vector<CacheSection> &sections)
+// 先写入临时文件, 完整写入后再重命名为path
+{
+    std::string tmp = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        static const char zeros[CACHE_ALIGN] = {};
+        size_t offset = 0;
+        auto write = [&](const void *data, size_t bytes)
+        {
+            out.write(static_cast<const char *>(data), bytes);
+            offset += bytes;
+        };
+        auto pad = [&]()
+        {
+            size_t r = offset % CACHE_ALIGN;
+            if (r)
+            {
+                write(zeros, CACHE_ALIGN - r);
+            }
+        };
+
+        write(&header, sizeof(header));
+        for (const CacheSection &s : sections)
+        {
+            pad();
+            write(s.data, s.bytes);
+        }
+        pad();
+        write(&CACHE_END_MARK, sizeof(CACHE_END_MARK));
+        out.flush();
+        if (!out)
+        {
+            out.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str()); // Windows上rename不能覆盖已有文件
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+class CacheReader
+// 按与writeCache相同的对齐方式依次读取各个数组
+{
+public:
+    std::ifstream in;
+    size_t offset;
+    CacheHeader header;
+    bool ok;
+
+    CacheReader(const std::string &path, uint32_t kind, uint64_t key)
+        : in(path, std::ios::binary), offset(0), ok(false)
+    {
+        if (!in || !in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        {
+            return;
+        }
+        offset = sizeof(header);
+        ok = std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header.version == CACHE_VERSION && header.build == FEMLIB_BUILD_ID && header.kind == kind && header.key == key;
+    }
+
+    void align()
+    {
+        size_t r = offset % CACHE_ALIGN;
+        if (r)
+        {
+            in.seekg(CACHE_ALIGN - r, std::ios::cur);
+            offset += CACHE_ALIGN - r;
+        }
+    }
+
+    bool section(void *data, size_t bytes)
+    {
+        align();
+        ok = ok && in.read(static_cast<char *>(data), bytes);
+        offset += bytes;
+        return ok;
+    }
+
+    bool finish()
+    {
+        uint64_t mark = 0;
+        section(&mark, sizeof(mark));
+        return ok && mark == CACHE_END_MARK && in.peek() == std::char_traits<char>::eof();
+    }
+};
+
+static CacheHeader makeHeader(uint32_t kind, uint64_t key, uint64_t rows)
+{
+    CacheHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    h.version = CACHE_VERSION;
+    h.build = FEMLIB_BUILD_ID;
+    h.kind = kind;
+    h.key = key;
+    h.rows = rows;
+    return h;
+}
+
+bool saveCSR(const std::string &path, const CSRMatrix &A, uint64_t key)
+{
+    CacheHeader h = makeHeader(CACHE_CSR, key, A.rows);
+    h.count[0] = A.row_offset.size;
+    h.count[1] = A.elm_idx.size;
+    h.count[2] = A.elements.size;
+    return writeCache(path, h, {{A.row_offset.data, A.row_offset.size * sizeof(size_t)}, {A.elm_idx.data, A.elm_idx.size * sizeof(size_t)}, {A.elements.data, A.elements.size * sizeof(double)}});
+}
+
+bool loadCSR(const std::string &path, CSRMatrix &A, uint64_t key)
+{
+    CacheReader reader(path, CACHE_CSR, key);
+    const CacheHeader &h = reader.header;
+    if (!reader.ok || h.rows != (uint64_t)A.rows || h.count[0] != (uint64_t)A.rows + 1 || h.count[1] != h.count[2])
+    {
+        return false;
+    }
+    TArray<size_t> row_offset(h.count[0]), elm_idx(h.count[1]);
+    Vec elements(h.count[2]);
+    if (!reader.section(row_offset.data, h.count[0] * sizeof(size_t)) || !reader.section(elm_idx.data, h.count[1] * sizeof(size_t)) || !reader.section(elements.data, h.count[2] * sizeof(double)) || !reader.finish())
+    {
+        return false;
+    }
+    A.row_offset = row_offset;
+    A.elm_idx = elm_idx;
+    A.elements = elements;
+    return true;
+}
+
+bool saveSKR(const std::string &path, const SKRMatrix &A, uint64_t key)
+{
+    CacheHeader h = makeHeader(CACHE_SKR, key, A.rows);
+    h.count[0] = A.column_offset.size;
+    h.count[1] = A.elements.size;
+    return writeCache(path, h, {{A.column_offset.data, A.column_offset.size * sizeof(size_t)}, {A.elements.data, A.elements.size * sizeof(double)}});
+}
+
+bool loadSKR(const std::string &path, SKRMatrix &A, uint64_t key)
+{
+    CacheReader reader(path, CACHE_SKR, key);
+    const CacheHeader &h = reader.header;
+    if (!reader.ok || h.count[0] != h.rows + 1)
+    {
+        return false;
+    }
+    TArray<size_t> column_offset(h.count[0]);
+    Vec elements(h.count[1]);
+    if (!reader.section(column_offset.data, h.count[0] * sizeof(size_t)) || !reader.section(elements.data, h.count[1] * sizeof(double)) || !reader.finish() || column_offset[h.rows] != h.count[1])
+    {
+        return false;
+    }
+    A.rows = h.rows;
+    A.cols = h.rows;
+    A.column_offset = column_offset;
+    A.elements = elements;
+    return true;
+}
+
+bool saveCholesky(const std::string &path, const Cholesky &chol, uint64_t key)
+{
+    if (!chol.isInitialized)
+    {
+        return false;
+    }
+    if (chol.mixedPrecision)
+    {
+        CacheHeader h = makeHeader(CACHE_CHOLESKY_FLOAT, key, chol.L.rows);
+        h.count[0] = chol.Lf.size;
+        return writeCache(path, h, {{chol.Lf.data, chol.Lf.size * sizeof(float)}});
+    }
+    CacheHeader h = makeHeader(CACHE_CHOLESKY, key, chol.L.rows);
+    h.count[0] = chol.L.elements.size;
+    return writeCache(path, h, {{chol.L.elements.data, chol.L.elements.size * sizeof(double)}});
+}
+
+bool loadCholesky(const std::string &path, Cholesky &chol, const CSRMatrix &A, double epsilon, uint64_t key)
+{
+    CacheReader reader(path, chol.mixedPrecision ? CACHE_CHOLESKY_FLOAT : CACHE_CHOLESKY, key);
+    if (!reader.ok || reader.header.rows != (uint64_t)A.rows)
+    {
+        return false;
+    }
+
+    // skyline结构由A的非零结构决定, 与文件中的长度比较
+    chol.analyze(A);
+    chol.loadValues(A, epsilon);
+    size_t nnz = chol.L.column_offset[A.rows];
+    if (reader.header.count[0] != nnz)
+    {
+        return false;
+    }
+
+    bool ok;
+    if (chol.mixedPrecision)
+    {
+        chol.Lf.resize(nnz);
+        ok = reader.section(chol.Lf.data, nnz * sizeof(float)) && reader.finish();
+        if (ok)
+        {
+            // 文件中只有单精度的L, invDiag由它计算
+            for (int i = 0; i < A.rows; ++i)
+            {
+                chol.invDiag[i] = 1.0 / chol.Lf[chol.L.column_offset[i + 1] - 1];
+            }
+            chol.L.elements = Vec();
+        }
+    }
+    else
+    {
+        chol.L.elements.resize(nnz);
+        ok = reader.section(chol.L.elements.data, nnz * sizeof(double)) && reader.finish();
+        if (ok)
+        {
+            chol.prepareSolve();
+        }
+    }
+    chol.isInitialized = ok;
+    return ok;
+}
+
+bool saveSupernodalCholesky(const std::string &path, const SupernodalCholesky &chol, uint64_t key)
+{
+    if (!chol.isInitialized)
+    {
+        return false;
+    }
+    int n = chol.n;
+    int ns = chol.nsuper;
+    CacheHeader h = makeHeader(CACHE_SUPERNODAL, key, n);
+    h.count[0] = ns;
+    h.count[1] = chol.rowIdx.size;
+    h.count[2] = chol.values.size;
+    h.count[3] = chol.colRow.size;
+    return writeCache(path, h, {{chol.perm.data, n * sizeof(int)}, {chol.iperm.data, n * sizeof(int)}, {chol.superStart.data, (ns + 1) * sizeof(int)}, {chol.colToSuper.data, n * sizeof(int)}, {chol.rowPtr.data, (ns + 1) * sizeof(size_t)}, {chol.rowIdx.data, chol.rowIdx.size * sizeof(int)}, {chol.valPtr.data, (ns + 1) * sizeof(size_t)}, {chol.values.data, chol.values.size * sizeof(double)}, {chol.colPtr.data, (n + 1) * sizeof(size_t)}, {chol.colRow.data, chol.colRow.size * sizeof(int)}, {chol.colSrc.data, chol.colSrc.size * sizeof(size_t)}});
+}
+
+bool loadSupernodalCholesky(const std::string &path, SupernodalCholesky &chol, const CSRMatrix &A, double epsilon, uint64_t key)
+{
+    CacheReader reader(path, CACHE_SUPERNODAL, key);
+    const CacheHeader &h = reader.header;
+    if (!reader.ok || h.rows != (uint64_t)A.rows)
+    {
+        return false;
+    }
+    int n = A.rows;
+    int ns = h.count[0];
+    TArray<int> perm(n), iperm(n), superStart(ns + 1), colToSuper(n), rowIdx(h.count[1]), colRow(h.count[3]);
+    TArray<size_t> rowPtr(ns + 1), valPtr(ns + 1), colPtr(n + 1), colSrc(h.count[3]);
+    Vec values(h.count[2]);
+    bool ok = reader.section(perm.data, n * sizeof(int)) && reader.section(iperm.data, n * sizeof(int)) && reader.section(superStart.data, (ns + 1) * sizeof(int)) && reader.section(colToSuper.data, n * sizeof(int)) && reader.section(rowPtr.data, (ns + 1) * sizeof(size_t)) && reader.section(rowIdx.data, h.count[1] * sizeof(int)) && reader.section(valPtr.data, (ns + 1) * sizeof(size_t)) && reader.section(values.data, h.count[2] * sizeof(double)) && reader.section(colPtr.data, (n + 1) * sizeof(size_t)) && reader.section(colRow.data, h.count[3] * sizeof(int)) && reader.section(colSrc.data, h.count[3] * sizeof(size_t)) && reader.finish();
+    // 各个数组之间的长度需要一致, colSrc指向A.elements, 需要在A的范围内
+    ok = ok && superStart[ns] == n && rowPtr[ns] == h.count[1] && valPtr[ns] == h.count[2] && colPtr[n] == h.count[3];
+    for (size_t t = 0; ok && t < colSrc.size; ++t)
+    {
+        ok = colSrc[t] < A.elements.size;
+    }
+    if (!ok)
+    {
+        return false;
+    }
+
+    chol.A = &A;
+    chol.n = n;
+    chol.epsilon = epsilon;
+    chol.nsuper = ns;
+    chol.perm = perm;
+    chol.iperm = iperm;
+    chol.superStart = superStart;
+    chol.colToSuper = colToSuper;
+    chol.rowPtr = rowPtr;
+    chol.rowIdx = rowIdx;
+    chol.valPtr = valPtr;
+    chol.values = values;
+    chol.colPtr = colPtr;
+    chol.colRow = colRow;
+    chol.colSrc = colSrc;
+    chol.work.resize(n);
+    chol.isInitialized = true;
+    return true;
+}
+
+NAMESPACE_END